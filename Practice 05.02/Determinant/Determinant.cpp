@@ -6,11 +6,12 @@
 #include <thread>
 #include <mutex>
 #include <chrono>
+#include "../../Practice 12.02/Thread Sync/Instrumented Mutex.h"
 
 using namespace std;
 using namespace chrono;
 
-mutex mtx;
+InstrumentedMutex mtx("mtx");
 
 double determinant(vector<vector<double>> matrix, int N);
 
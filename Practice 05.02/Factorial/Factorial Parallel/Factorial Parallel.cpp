@@ -3,11 +3,12 @@
 #include <vector>
 #include <mutex>
 #include <chrono>
+#include "../../../Practice 12.02/Thread Sync/Instrumented Mutex.h"
 
 using namespace std;
 using namespace chrono;
 
-mutex mtx;
+InstrumentedMutex mtx("mtx");
 long long global_result = 1;
 
 void partial_factorial(long long start, long long end) {
@@ -16,7 +17,7 @@ void partial_factorial(long long start, long long end) {
         local_result *= i;
     }
 
-    lock_guard<mutex> lock(mtx);
+    INSTRUMENTED_LOCK(lock, mtx);
     global_result *= local_result;
 }
 
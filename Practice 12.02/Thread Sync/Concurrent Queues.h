@@ -0,0 +1,252 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <type_traits>
+#include <vector>
+
+// Размер строки кэша: счётчики разных сторон очереди держим на разных строках,
+// чтобы производители и потребители не "перетягивали" одну и ту же строку
+const size_t CACHE_LINE = 64;
+
+// Ограниченная lock-free MPMC очередь (кольцевой буфер Вьюкова).
+// У каждой ячейки есть номер последовательности: по нему производитель понимает,
+// что ячейка свободна, а потребитель - что в ней лежат готовые данные.
+template <typename T>
+class MPMCQueue {
+public:
+    // Ёмкость округляется вверх до степени двойки
+    explicit MPMCQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        mask = cap - 1;
+        cells.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    // Возвращает false, если очередь заполнена
+    bool try_push(const T& value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                // Ячейка свободна - пытаемся занять позицию
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Возвращает false, если очередь пуста
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        value = cell->data;
+        // Освобождаем ячейку для производителя следующего круга
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    alignas(CACHE_LINE) std::atomic<size_t> enqueue_pos;
+    alignas(CACHE_LINE) std::atomic<size_t> dequeue_pos;
+};
+
+// Дек с перехватом работы Чейза-Лева (по варианту для модели памяти C11 из работы Lê и др.).
+// Владелец кладёт и забирает задачи с нижнего конца, остальные потоки крадут с верхнего.
+// Элементы хранятся в атомарных ячейках, поэтому T должен быть тривиально копируемым.
+template <typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable<T>::value, "WorkStealingDeque requires a trivially copyable type");
+
+public:
+    enum class StealResult { Success, Empty, Abort };
+
+    explicit WorkStealingDeque(size_t capacity = 1024) {
+        size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        arrays.emplace_back(new Array(cap));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+        top.store(0, std::memory_order_relaxed);
+        bottom.store(0, std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Только владелец
+    void push(const T& value) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t > (int64_t)a->capacity - 1)
+            a = grow(a, t, b);
+        a->put(b, value);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Только владелец. Возвращает false, если дек пуст
+    bool take(T& value) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        // Пара seq_cst операций вместо отдельного барьера: запись bottom не может
+        // переупорядочиться с чтением top (ThreadSanitizer не поддерживает atomic_thread_fence)
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        value = a->get(b);
+        if (t == b) {
+            // Последний элемент - соревнуемся с ворами
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Любой поток. Abort означает проигранную гонку - можно повторить попытку
+    StealResult steal(T& value) {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b)
+            return StealResult::Empty;
+
+        Array* a = array.load(std::memory_order_acquire);
+        T result = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return StealResult::Abort;
+        value = result;
+        return StealResult::Success;
+    }
+
+    size_t size_approx() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? (size_t)(b - t) : 0;
+    }
+
+private:
+    struct Array {
+        size_t capacity;
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Array(size_t cap) : capacity(cap), mask(cap - 1), slots(new std::atomic<T>[cap]) {}
+
+        T get(int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, const T& v) { slots[i & mask].store(v, std::memory_order_relaxed); }
+    };
+
+    // Увеличение буфера вдвое. Старые массивы не освобождаются до разрушения дека,
+    // потому что вор мог успеть прочитать указатель на них
+    Array* grow(Array* old, int64_t t, int64_t b) {
+        Array* bigger = new Array(old->capacity * 2);
+        for (int64_t i = t; i < b; ++i)
+            bigger->put(i, old->get(i));
+        arrays.emplace_back(bigger);
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(CACHE_LINE) std::atomic<int64_t> top;
+    alignas(CACHE_LINE) std::atomic<int64_t> bottom;
+    alignas(CACHE_LINE) std::atomic<Array*> array;
+    std::vector<std::unique_ptr<Array>> arrays; // изменяется только владельцем
+};
+
+// Ограниченная очередь на mutex + condition_variable - базовый вариант для сравнения
+template <typename T>
+class MutexQueue {
+public:
+    explicit MutexQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(const T& value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_full.wait(lock, [this] { return items.size() < capacity; });
+        items.push(value);
+        lock.unlock();
+        not_empty.notify_one();
+    }
+
+    void pop(T& value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_empty.wait(lock, [this] { return !items.empty(); });
+        value = items.front();
+        items.pop();
+        lock.unlock();
+        not_full.notify_one();
+    }
+
+    bool try_pop(T& value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (items.empty())
+            return false;
+        value = items.front();
+        items.pop();
+        lock.unlock();
+        not_full.notify_one();
+        return true;
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    std::queue<T> items;
+    size_t capacity;
+};
@@ -0,0 +1,225 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Мьютекс со статистикой: число захватов, число захватов с ожиданием, число передач
+// блокировки другому потоку и гистограммы времени ожидания и удержания по местам захвата.
+// Вся статистика места обновляется, пока блокировка удерживается, поэтому атомарные
+// операции не нужны. Отчёт печатается в stderr при завершении программы.
+
+// Гистограмма по степеням двойки: корзина k содержит интервалы [2^(k-1), 2^k) нс
+const int LOCK_HIST_BUCKETS = 40;
+
+struct LockSiteStats {
+    std::string name;
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;   // захваты, которым пришлось ждать
+    uint64_t handoffs = 0;    // захваты потоком, отличным от предыдущего владельца
+    uint64_t total_wait_ns = 0;
+    uint64_t total_hold_ns = 0;
+    uint64_t max_wait_ns = 0;
+    uint64_t max_hold_ns = 0;
+    uint64_t wait_hist[LOCK_HIST_BUCKETS] = {};
+    uint64_t hold_hist[LOCK_HIST_BUCKETS] = {};
+
+    explicit LockSiteStats(const std::string& name) : name(name) {}
+
+    static int bucket(uint64_t ns) {
+        int b = 0;
+        while (ns && b < LOCK_HIST_BUCKETS - 1) {
+            ns >>= 1;
+            ++b;
+        }
+        return b;
+    }
+
+    void record_wait(uint64_t ns) {
+        total_wait_ns += ns;
+        if (ns > max_wait_ns)
+            max_wait_ns = ns;
+        ++wait_hist[bucket(ns)];
+    }
+
+    void record_hold(uint64_t ns) {
+        total_hold_ns += ns;
+        if (ns > max_hold_ns)
+            max_hold_ns = ns;
+        ++hold_hist[bucket(ns)];
+    }
+};
+
+// Реестр всех мест захвата. Владеет статистикой, чтобы отчёт можно было напечатать
+// после разрушения глобальных мьютексов
+class LockRegistry {
+public:
+    static LockRegistry& instance() {
+        static LockRegistry registry;
+        return registry;
+    }
+
+    LockSiteStats* create(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mtx);
+        sites.emplace_back(new LockSiteStats(name));
+        return sites.back().get();
+    }
+
+    ~LockRegistry() { report(); }
+
+    void report() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (sites.empty())
+            return;
+        fflush(stdout); // чтобы отчёт не перемешался с буферизованным выводом программы
+        fprintf(stderr, "\n=== Lock contention report (hardware threads: %u) ===\n",
+                std::thread::hardware_concurrency());
+        for (const auto& s : sites) {
+            fprintf(stderr, "\n[%s]\n", s->name.c_str());
+            if (s->acquisitions == 0) {
+                fprintf(stderr, "  no acquisitions\n");
+                continue;
+            }
+            double n = (double)s->acquisitions;
+            fprintf(stderr, "  acquisitions: %llu, contended: %llu (%.1f%%), handoffs: %llu (%.1f%%)\n",
+                    (unsigned long long)s->acquisitions,
+                    (unsigned long long)s->contended, 100.0 * s->contended / n,
+                    (unsigned long long)s->handoffs, 100.0 * s->handoffs / n);
+            fprintf(stderr, "  wait: avg %.1f ns, p50 < %s, p99 < %s, max %llu ns, total %.3f ms\n",
+                    s->total_wait_ns / n, percentile(s->wait_hist, n, 0.50).c_str(),
+                    percentile(s->wait_hist, n, 0.99).c_str(),
+                    (unsigned long long)s->max_wait_ns, s->total_wait_ns / 1e6);
+            fprintf(stderr, "  hold: avg %.1f ns, p50 < %s, p99 < %s, max %llu ns, total %.3f ms\n",
+                    s->total_hold_ns / n, percentile(s->hold_hist, n, 0.50).c_str(),
+                    percentile(s->hold_hist, n, 0.99).c_str(),
+                    (unsigned long long)s->max_hold_ns, s->total_hold_ns / 1e6);
+            print_histogram("wait", s->wait_hist);
+            print_histogram("hold", s->hold_hist);
+        }
+    }
+
+private:
+    LockRegistry() = default;
+
+    static std::string bucket_limit(int b) {
+        return b == 0 ? "1 ns" : std::to_string(1ULL << b) + " ns";
+    }
+
+    // Верхняя граница корзины, в которую попадает заданная доля захватов
+    static std::string percentile(const uint64_t* hist, double total, double q) {
+        double acc = 0;
+        for (int b = 0; b < LOCK_HIST_BUCKETS; ++b) {
+            acc += hist[b];
+            if (acc >= q * total)
+                return bucket_limit(b);
+        }
+        return bucket_limit(LOCK_HIST_BUCKETS - 1);
+    }
+
+    static void print_histogram(const char* title, const uint64_t* hist) {
+        fprintf(stderr, "  %s histogram:\n", title);
+        for (int b = 0; b < LOCK_HIST_BUCKETS; ++b) {
+            if (hist[b] == 0)
+                continue;
+            fprintf(stderr, "    < %-12s %llu\n", bucket_limit(b).c_str(), (unsigned long long)hist[b]);
+        }
+    }
+
+    std::mutex mtx;
+    std::vector<std::unique_ptr<LockSiteStats>> sites;
+};
+
+// Замена std::mutex с тем же интерфейсом (подходит для lock_guard и unique_lock).
+// Захваты через lock() попадают в статистику самого мьютекса, захваты через
+// InstrumentedLockGuard - в статистику указанного места
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(const std::string& name = "mutex")
+        : default_site(LockRegistry::instance().create(name)) {}
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    void lock() { lock_at(default_site); }
+
+    bool try_lock() {
+        if (!mtx.try_lock())
+            return false;
+        on_acquired(default_site, false, clock::now(), 0);
+        return true;
+    }
+
+    void unlock() {
+        uint64_t hold = elapsed_ns(acquired_at, clock::now());
+        current_site->record_hold(hold);
+        mtx.unlock();
+    }
+
+    void lock_at(LockSiteStats* site) {
+        // Быстрый путь без ожидания: только одно чтение часов
+        if (mtx.try_lock()) {
+            on_acquired(site, false, clock::now(), 0);
+            return;
+        }
+        auto start = clock::now();
+        mtx.lock();
+        auto now = clock::now();
+        on_acquired(site, true, now, elapsed_ns(start, now));
+    }
+
+    LockSiteStats* stats() const { return default_site; }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    static uint64_t elapsed_ns(clock::time_point from, clock::time_point to) {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    }
+
+    // Вызывается уже под блокировкой
+    void on_acquired(LockSiteStats* site, bool was_contended, clock::time_point now, uint64_t wait_ns) {
+        std::thread::id self = std::this_thread::get_id();
+        ++site->acquisitions;
+        if (was_contended)
+            ++site->contended;
+        if (self != last_owner) {
+            ++site->handoffs;
+            last_owner = self;
+        }
+        site->record_wait(wait_ns);
+        current_site = site;
+        acquired_at = now;
+    }
+
+    std::mutex mtx;
+    LockSiteStats* default_site;
+    LockSiteStats* current_site = nullptr;
+    clock::time_point acquired_at;
+    std::thread::id last_owner;
+};
+
+// Захват с привязкой к месту в коде. Место должно использоваться только с одним мьютексом,
+// иначе его статистика будет изменяться под разными блокировками
+class InstrumentedLockGuard {
+public:
+    InstrumentedLockGuard(InstrumentedMutex& m, LockSiteStats* site) : m(m) { m.lock_at(site); }
+    ~InstrumentedLockGuard() { m.unlock(); }
+
+    InstrumentedLockGuard(const InstrumentedLockGuard&) = delete;
+    InstrumentedLockGuard& operator=(const InstrumentedLockGuard&) = delete;
+
+private:
+    InstrumentedMutex& m;
+};
+
+// INSTRUMENTED_LOCK(lock, mtx); - аналог lock_guard<mutex> lock(mtx), статистика
+// собирается отдельно для функции и строки, где стоит захват
+#define INSTRUMENTED_LOCK(guard, mtx)                                                        \
+    static LockSiteStats* guard##_site = LockRegistry::instance().create(                    \
+        std::string(#mtx " @ ") + __func__ + ":" + std::to_string(__LINE__));                \
+    InstrumentedLockGuard guard(mtx, guard##_site)
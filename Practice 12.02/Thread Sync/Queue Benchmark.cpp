@@ -0,0 +1,286 @@
+﻿// Сравнение lock-free MPMC очереди и дека Чейза-Лева с очередью на mutex + condition_variable.
+// Стресс-проверки рассчитаны на запуск под ThreadSanitizer:
+//   g++ -std=c++17 -O1 -g -fsanitize=thread -pthread "Queue Benchmark.cpp"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "Concurrent Queues.h"
+
+using namespace std;
+using namespace chrono;
+
+// Элемент очереди: номер производителя в старших 32 битах, порядковый номер в младших
+uint64_t make_item(uint32_t producer, uint32_t seq) {
+    return ((uint64_t)producer << 32) | seq;
+}
+
+struct RunResult {
+    double ms;
+    bool correct;
+};
+
+// Проверка истории: каждый элемент получен ровно один раз, а каждый потребитель
+// видит элементы одного производителя в порядке их добавления (FIFO)
+struct HistoryChecker {
+    int producers;
+    int items_per_producer;
+    vector<atomic<int>> seen;
+    atomic<bool> order_ok;
+
+    HistoryChecker(int producers, int items_per_producer)
+        : producers(producers), items_per_producer(items_per_producer),
+          seen((size_t)producers * items_per_producer), order_ok(true) {
+        for (auto& s : seen)
+            s.store(0, memory_order_relaxed);
+    }
+
+    void record(uint64_t item, vector<int64_t>& last_seq) {
+        uint32_t p = (uint32_t)(item >> 32);
+        uint32_t seq = (uint32_t)item;
+        if ((int64_t)seq <= last_seq[p])
+            order_ok.store(false, memory_order_relaxed);
+        last_seq[p] = seq;
+        seen[(size_t)p * items_per_producer + seq].fetch_add(1, memory_order_relaxed);
+    }
+
+    bool ok() const {
+        if (!order_ok.load())
+            return false;
+        for (const auto& s : seen)
+            if (s.load() != 1)
+                return false;
+        return true;
+    }
+};
+
+RunResult run_mpmc(int producers, int consumers, int items_per_producer, size_t capacity) {
+    MPMCQueue<uint64_t> queue(capacity);
+    HistoryChecker checker(producers, items_per_producer);
+    const int64_t total = (int64_t)producers * items_per_producer;
+    atomic<int64_t> consumed(0);
+
+    vector<thread> threads;
+    auto start = high_resolution_clock::now();
+
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < items_per_producer; ++i) {
+                uint64_t item = make_item(p, i);
+                while (!queue.try_push(item))
+                    this_thread::yield();
+            }
+        });
+
+    for (int c = 0; c < consumers; ++c)
+        threads.emplace_back([&] {
+            vector<int64_t> last_seq(producers, -1);
+            uint64_t item;
+            while (consumed.load(memory_order_relaxed) < total) {
+                if (queue.try_pop(item)) {
+                    checker.record(item, last_seq);
+                    consumed.fetch_add(1, memory_order_relaxed);
+                }
+                else {
+                    this_thread::yield();
+                }
+            }
+        });
+
+    for (auto& th : threads)
+        th.join();
+
+    auto end = high_resolution_clock::now();
+    return { duration<double, milli>(end - start).count(), checker.ok() };
+}
+
+RunResult run_mutex(int producers, int consumers, int items_per_producer, size_t capacity) {
+    MutexQueue<uint64_t> queue(capacity);
+    HistoryChecker checker(producers, items_per_producer);
+    const int64_t total = (int64_t)producers * items_per_producer;
+
+    vector<thread> threads;
+    auto start = high_resolution_clock::now();
+
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < items_per_producer; ++i)
+                queue.push(make_item(p, i));
+        });
+
+    // Потребители заранее знают свою долю элементов, поэтому могут блокироваться в pop
+    for (int c = 0; c < consumers; ++c) {
+        int64_t share = total / consumers + (c < total % consumers ? 1 : 0);
+        threads.emplace_back([&, share] {
+            vector<int64_t> last_seq(producers, -1);
+            uint64_t item;
+            for (int64_t i = 0; i < share; ++i) {
+                queue.pop(item);
+                checker.record(item, last_seq);
+            }
+        });
+    }
+
+    for (auto& th : threads)
+        th.join();
+
+    auto end = high_resolution_clock::now();
+    return { duration<double, milli>(end - start).count(), checker.ok() };
+}
+
+// Владелец порождает задачи пачками и сам их выполняет, воры забирают задачи с другого конца.
+// Каждый вор должен видеть номера задач строго по возрастанию (верх дека - FIFO)
+RunResult run_work_stealing(int thieves, int tasks, int burst) {
+    WorkStealingDeque<uint32_t> deque(64);
+    vector<atomic<int>> seen(tasks);
+    for (auto& s : seen)
+        s.store(0, memory_order_relaxed);
+    atomic<int> done(0);
+    atomic<bool> order_ok(true);
+
+    vector<thread> threads;
+    auto start = high_resolution_clock::now();
+
+    threads.emplace_back([&] {
+        uint32_t next = 0;
+        uint32_t task;
+        while (next < (uint32_t)tasks) {
+            for (int i = 0; i < burst && next < (uint32_t)tasks; ++i)
+                deque.push(next++);
+            // Забираем половину пачки сами, остальное оставляем ворам
+            for (int i = 0; i < burst / 2 && deque.take(task); ++i) {
+                seen[task].fetch_add(1, memory_order_relaxed);
+                done.fetch_add(1, memory_order_relaxed);
+            }
+        }
+        while (deque.take(task)) {
+            seen[task].fetch_add(1, memory_order_relaxed);
+            done.fetch_add(1, memory_order_relaxed);
+        }
+    });
+
+    for (int t = 0; t < thieves; ++t)
+        threads.emplace_back([&] {
+            int64_t last = -1;
+            uint32_t task;
+            while (done.load(memory_order_relaxed) < tasks) {
+                auto result = deque.steal(task);
+                if (result == WorkStealingDeque<uint32_t>::StealResult::Success) {
+                    if ((int64_t)task <= last)
+                        order_ok.store(false, memory_order_relaxed);
+                    last = task;
+                    seen[task].fetch_add(1, memory_order_relaxed);
+                    done.fetch_add(1, memory_order_relaxed);
+                }
+                else if (result == WorkStealingDeque<uint32_t>::StealResult::Empty) {
+                    this_thread::yield();
+                }
+            }
+        });
+
+    for (auto& th : threads)
+        th.join();
+
+    auto end = high_resolution_clock::now();
+
+    bool correct = order_ok.load();
+    for (const auto& s : seen)
+        if (s.load() != 1)
+            correct = false;
+    return { duration<double, milli>(end - start).count(), correct };
+}
+
+// Та же схема, но общий пул задач - очередь на mutex
+RunResult run_mutex_pool(int thieves, int tasks, int burst) {
+    MutexQueue<uint32_t> queue(tasks);
+    vector<atomic<int>> seen(tasks);
+    for (auto& s : seen)
+        s.store(0, memory_order_relaxed);
+    atomic<int> done(0);
+
+    vector<thread> threads;
+    auto start = high_resolution_clock::now();
+
+    threads.emplace_back([&] {
+        uint32_t next = 0;
+        uint32_t task;
+        while (next < (uint32_t)tasks) {
+            for (int i = 0; i < burst && next < (uint32_t)tasks; ++i)
+                queue.push(next++);
+            for (int i = 0; i < burst / 2 && queue.try_pop(task); ++i) {
+                seen[task].fetch_add(1, memory_order_relaxed);
+                done.fetch_add(1, memory_order_relaxed);
+            }
+        }
+        while (queue.try_pop(task)) {
+            seen[task].fetch_add(1, memory_order_relaxed);
+            done.fetch_add(1, memory_order_relaxed);
+        }
+    });
+
+    for (int t = 0; t < thieves; ++t)
+        threads.emplace_back([&] {
+            uint32_t task;
+            while (done.load(memory_order_relaxed) < tasks) {
+                if (queue.try_pop(task)) {
+                    seen[task].fetch_add(1, memory_order_relaxed);
+                    done.fetch_add(1, memory_order_relaxed);
+                }
+                else {
+                    this_thread::yield();
+                }
+            }
+        });
+
+    for (auto& th : threads)
+        th.join();
+
+    auto end = high_resolution_clock::now();
+
+    bool correct = true;
+    for (const auto& s : seen)
+        if (s.load() != 1)
+            correct = false;
+    return { duration<double, milli>(end - start).count(), correct };
+}
+
+void print_result(const char* name, const RunResult& r, int64_t items) {
+    double mops = r.ms > 0 ? items / (r.ms * 1000.0) : 0.0;
+    cout << name << ": " << r.ms << " ms, " << mops << " Mops/s, "
+         << (r.correct ? "correct" : "INCORRECT") << endl;
+}
+
+int main() {
+    const int items_per_producer = 200000;
+    const size_t capacity = 1024;
+    const int num_tasks = 1000000;
+    const int burst = 64;
+
+    // Конфигурации производителей и потребителей
+    const int configs[][2] = { {1, 1}, {2, 2}, {4, 4}, {1, 4}, {4, 1} };
+
+    cout << "=== Producer/consumer throughput (queue capacity " << capacity << ") ===\n";
+    for (const auto& cfg : configs) {
+        int producers = cfg[0];
+        int consumers = cfg[1];
+        int64_t items = (int64_t)producers * items_per_producer;
+
+        cout << "\nProducers: " << producers << ", consumers: " << consumers << endl;
+        print_result("  Lock-free MPMC  ", run_mpmc(producers, consumers, items_per_producer, capacity), items);
+        print_result("  Mutex + condvar ", run_mutex(producers, consumers, items_per_producer, capacity), items);
+    }
+
+    cout << "\n=== Work stealing (" << num_tasks << " tasks, burst " << burst << ") ===\n";
+    for (int thieves : { 1, 3, 7 }) {
+        cout << "\nThieves: " << thieves << endl;
+        print_result("  Chase-Lev deque ", run_work_stealing(thieves, num_tasks, burst), num_tasks);
+        print_result("  Mutex task pool ", run_mutex_pool(thieves, num_tasks, burst), num_tasks);
+    }
+
+    cout << "\nHardware threads: " << thread::hardware_concurrency() << endl;
+
+    return 0;
+}
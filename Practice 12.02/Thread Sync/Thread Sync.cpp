@@ -4,11 +4,13 @@
 #include <mutex>
 #include <chrono>
 #include <atomic>
+#include "Instrumented Mutex.h"
 
 using namespace std;
 using namespace chrono;
 
-mutex mtx;
+// Мьютекс со сбором статистики ожидания и удержания (отчёт печатается при выходе)
+InstrumentedMutex mtx("mtx");
 
 int safe_sum = 0;
 int unsafe_sum = 0;
@@ -16,7 +18,7 @@ atomic<int> atomic_sum(0);
 
 void safe_add(int id, int iterations) {
     for (int i = 0; i < iterations; ++i) {
-        lock_guard<mutex> lock(mtx);
+        INSTRUMENTED_LOCK(lock, mtx);
         safe_sum += id;
     }
 }
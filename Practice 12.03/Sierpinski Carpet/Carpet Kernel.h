@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Маска троичных цифр координаты: бит k установлен, если k-я (от старшей) цифра равна 1.
+// Учитываются только уровни, на которых квадрат ещё делится на 3 (как в drawCarpet,
+// где при newSize == 0 дыры больше не появляются)
+inline std::vector<uint32_t> buildDigitMask(int size, int depth) {
+    std::vector<uint32_t> mask(size, 0);
+    for (int c = 0; c < size; ++c) {
+        int cell = size;
+        for (int k = 0; k < depth && cell >= 3; ++k) {
+            cell /= 3;
+            if ((c / cell) % 3 == 1)
+                mask[c] |= 1u << k;
+        }
+    }
+    return mask;
+}
+
+// Битовые плоскости уровней для упакованных строк: в плоскости k бит x установлен,
+// если k-я цифра x равна 1. Старший бит байта - левый пиксель (как в PNG и PBM)
+inline std::vector<std::vector<uint8_t>> buildDigitPlanes(int size, int depth) {
+    const int row_bytes = (size + 7) / 8;
+    std::vector<std::vector<uint8_t>> planes;
+    int cell = size;
+    for (int k = 0; k < depth && cell >= 3; ++k) {
+        cell /= 3;
+        std::vector<uint8_t> plane(row_bytes, 0);
+        for (int x = 0; x < size; ++x)
+            if ((x / cell) % 3 == 1)
+                plane[x >> 3] |= (uint8_t)(0x80 >> (x & 7));
+        planes.push_back(plane);
+    }
+    return planes;
+}
+
+// Упакованная строка ковра: 1 - пиксель ковра, 0 - дыра. Дыры строки y - объединение
+// плоскостей тех уровней, где цифра y равна 1 (maskY из buildDigitMask)
+inline void carpetRowBits(const std::vector<std::vector<uint8_t>>& planes, uint32_t maskY, int size, uint8_t* out) {
+    const int row_bytes = (size + 7) / 8;
+    for (int i = 0; i < row_bytes; ++i)
+        out[i] = 0;
+    for (size_t k = 0; k < planes.size(); ++k) {
+        if (!(maskY & (1u << k)))
+            continue;
+        const uint8_t* plane = planes[k].data();
+        for (int i = 0; i < row_bytes; ++i)
+            out[i] |= plane[i];
+    }
+    for (int i = 0; i < row_bytes; ++i)
+        out[i] = (uint8_t)~out[i];
+    // Биты за правым краем изображения обнуляем
+    if (size & 7)
+        out[row_bytes - 1] &= (uint8_t)(0xFF << (8 - (size & 7)));
+}
@@ -0,0 +1,283 @@
+﻿// Потоковая отрисовка больших ковров Серпинского на диск без окна и без хранения
+// всего изображения в памяти. Полосы строк считаются параллельно и записываются по порядку
+// через ограниченный набор буферов.
+//   g++ -O2 -std=c++17 -pthread "Carpet Stream.cpp" -lz
+//   ./a.out <depth> <out.png|out.pbm> [strip_rows] [threads]
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <zlib.h>
+#include "Carpet Kernel.h"
+
+using namespace std;
+using namespace chrono;
+
+// Палитра PNG: индекс 0 - фон (белый), индекс 1 - ковёр (синий, как CARPET_COLOR)
+const uint8_t PALETTE[6] = { 255, 255, 255, 0, 0, 255 };
+
+enum class Format { PNG, PBM };
+
+// Буфер одной полосы: упакованные строки и, для PNG, их сжатое представление
+struct StripSlot {
+    vector<uint8_t> raw;
+    vector<uint8_t> compressed;
+    uLong adler = 1;
+    uLong raw_size = 0;
+    bool compressed_ok = true;
+    long long strip = -1; // номер готовой полосы в буфере, -1 - буфер свободен
+};
+
+void put_u32(vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+void write_png_chunk(ofstream& file, const char* type, const uint8_t* data, size_t size) {
+    vector<uint8_t> header;
+    put_u32(header, (uint32_t)size);
+    header.insert(header.end(), type, type + 4);
+    file.write((const char*)header.data(), header.size());
+    if (size)
+        file.write((const char*)data, size);
+
+    uLong crc = crc32(0L, (const Bytef*)type, 4);
+    if (size)
+        crc = crc32(crc, data, (uInt)size);
+    vector<uint8_t> tail;
+    put_u32(tail, (uint32_t)crc);
+    file.write((const char*)tail.data(), tail.size());
+}
+
+// Сжатие полосы отдельным raw deflate потоком. Все полосы, кроме последней, заканчиваются
+// Z_SYNC_FLUSH (выравнивание на байт без завершающего блока), поэтому их можно просто
+// склеить в один zlib поток - так же, как это делает pigz. false - ошибка zlib
+bool compress_strip(StripSlot& slot, bool last) {
+    z_stream zs = {};
+    if (deflateInit2(&zs, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    slot.compressed.resize(deflateBound(&zs, slot.raw_size) + 64);
+    zs.next_in = slot.raw.data();
+    zs.avail_in = (uInt)slot.raw_size;
+    size_t produced = 0;
+    int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    for (;;) {
+        zs.next_out = slot.compressed.data() + produced;
+        zs.avail_out = (uInt)(slot.compressed.size() - produced);
+        int ret = deflate(&zs, flush);
+        if (ret == Z_STREAM_ERROR) {
+            deflateEnd(&zs);
+            return false;
+        }
+        produced = slot.compressed.size() - zs.avail_out;
+        if (last ? ret == Z_STREAM_END : (zs.avail_in == 0 && zs.avail_out != 0))
+            break;
+        slot.compressed.resize(slot.compressed.size() * 2);
+    }
+    deflateEnd(&zs);
+    slot.compressed.resize(produced);
+    slot.adler = adler32(1L, slot.raw.data(), (uInt)slot.raw_size);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " <depth> <out.png|out.pbm> [strip_rows] [threads]" << endl;
+        return -1;
+    }
+
+    int depth = atoi(argv[1]);
+    string path = argv[2];
+    int strip_rows = argc > 3 ? atoi(argv[3]) : 64;
+    int num_threads = argc > 4 ? atoi(argv[4]) : (int)thread::hardware_concurrency();
+    if (num_threads < 1)
+        num_threads = 1;
+
+    if (depth < 1 || depth > 13 || strip_rows < 1) {
+        cout << "Invalid arguments: depth must be 1-13, strip_rows at least 1" << endl;
+        return -1;
+    }
+
+    Format format;
+    if (path.size() >= 4 && path.substr(path.size() - 4) == ".png")
+        format = Format::PNG;
+    else if (path.size() >= 4 && path.substr(path.size() - 4) == ".pbm")
+        format = Format::PBM;
+    else {
+        cout << "Output file must end with .png or .pbm" << endl;
+        return -1;
+    }
+
+    // Размер - степень тройки, чтобы каждый уровень делился без остатка
+    int size = 1;
+    for (int i = 0; i < depth; ++i)
+        size *= 3;
+
+    const int row_bytes = (size + 7) / 8;
+    // В PNG перед каждой строкой стоит байт фильтра
+    const int stored_row = format == Format::PNG ? row_bytes + 1 : row_bytes;
+    const long long num_strips = (size + strip_rows - 1) / strip_rows;
+
+    // Таблицы размером в одну строку - не зависят от высоты изображения
+    vector<uint32_t> maskY = buildDigitMask(size, depth);
+    vector<vector<uint8_t>> planes = buildDigitPlanes(size, depth);
+
+    ofstream file(path, ios::binary);
+    if (!file) {
+        cout << "Error: failed to open " << path << endl;
+        return -1;
+    }
+
+    if (format == Format::PNG) {
+        const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        file.write((const char*)signature, 8);
+
+        vector<uint8_t> ihdr;
+        put_u32(ihdr, (uint32_t)size);
+        put_u32(ihdr, (uint32_t)size);
+        ihdr.push_back(1); // 1 бит на пиксель
+        ihdr.push_back(3); // палитра
+        ihdr.push_back(0);
+        ihdr.push_back(0);
+        ihdr.push_back(0);
+        write_png_chunk(file, "IHDR", ihdr.data(), ihdr.size());
+        write_png_chunk(file, "PLTE", PALETTE, sizeof(PALETTE));
+
+        const uint8_t zlib_header[2] = { 0x78, 0x9C };
+        write_png_chunk(file, "IDAT", zlib_header, 2);
+    }
+    else {
+        string header = "P4\n" + to_string(size) + " " + to_string(size) + "\n";
+        file.write(header.data(), header.size());
+    }
+
+    // Ограниченный конвейер: не больше двух полос на поток находятся в памяти одновременно
+    const int num_slots = 2 * num_threads;
+    vector<StripSlot> slots(num_slots);
+    for (auto& slot : slots)
+        slot.raw.resize((size_t)strip_rows * stored_row);
+
+    mutex mtx;
+    condition_variable slot_freed, strip_ready;
+    long long written = 0;
+    atomic<long long> next_strip(0);
+
+    auto start = high_resolution_clock::now();
+
+    vector<thread> workers;
+    for (int t = 0; t < num_threads; ++t)
+        workers.emplace_back([&] {
+            for (;;) {
+                long long strip = next_strip.fetch_add(1);
+                if (strip >= num_strips)
+                    break;
+                StripSlot& slot = slots[strip % num_slots];
+
+                // Ждём, пока писатель освободит буфер от полосы strip - num_slots
+                {
+                    unique_lock<mutex> lock(mtx);
+                    slot_freed.wait(lock, [&] { return written > strip - num_slots; });
+                }
+
+                int y0 = (int)(strip * strip_rows);
+                int rows = min(strip_rows, size - y0);
+                for (int r = 0; r < rows; ++r) {
+                    uint8_t* row = slot.raw.data() + (size_t)r * stored_row;
+                    if (format == Format::PNG)
+                        *row++ = 0; // фильтр None
+                    carpetRowBits(planes, maskY[y0 + r], size, row);
+                }
+                slot.raw_size = (uLong)rows * stored_row;
+
+                // Писатель ждёт каждую полосу, поэтому и при ошибке сжатия полоса отдаётся ему
+                if (format == Format::PNG)
+                    slot.compressed_ok = compress_strip(slot, strip == num_strips - 1);
+
+                {
+                    lock_guard<mutex> lock(mtx);
+                    slot.strip = strip;
+                }
+                strip_ready.notify_all();
+            }
+        });
+
+    // Писатель: полосы уходят в файл строго по порядку. После ошибки запись прекращается,
+    // но полосы забираются до конца, чтобы рабочие потоки не ждали свободных буферов
+    string error;
+    uLong adler = 1;
+    long long compressed_bytes = 0;
+    for (long long strip = 0; strip < num_strips; ++strip) {
+        StripSlot& slot = slots[strip % num_slots];
+        {
+            unique_lock<mutex> lock(mtx);
+            strip_ready.wait(lock, [&] { return slot.strip == strip; });
+        }
+
+        if (error.empty()) {
+            if (format == Format::PNG && !slot.compressed_ok) {
+                error = "zlib failed to compress strip " + to_string(strip);
+            }
+            else if (format == Format::PNG) {
+                write_png_chunk(file, "IDAT", slot.compressed.data(), slot.compressed.size());
+                adler = adler32_combine(adler, slot.adler, (z_off_t)slot.raw_size);
+                compressed_bytes += (long long)slot.compressed.size();
+            }
+            else {
+                file.write((const char*)slot.raw.data(), slot.raw_size);
+            }
+            if (error.empty() && !file)
+                error = "failed to write " + path;
+        }
+
+        {
+            lock_guard<mutex> lock(mtx);
+            slot.strip = -1;
+            written = strip + 1;
+        }
+        slot_freed.notify_all();
+    }
+
+    for (auto& th : workers)
+        th.join();
+
+    if (format == Format::PNG && error.empty()) {
+        vector<uint8_t> checksum;
+        put_u32(checksum, (uint32_t)adler);
+        write_png_chunk(file, "IDAT", checksum.data(), checksum.size());
+        write_png_chunk(file, "IEND", nullptr, 0);
+    }
+    // Ошибка записи (например, кончилось место) видна только по состоянию потока после сброса
+    file.close();
+    if (error.empty() && !file)
+        error = "failed to write " + path;
+    if (!error.empty()) {
+        cout << "Error: " << error << ", the output file is incomplete" << endl;
+        return -1;
+    }
+
+    auto end = high_resolution_clock::now();
+    double seconds = duration<double>(end - start).count();
+    double megapixels = (double)size * size / 1e6;
+    double buffer_mb = (double)num_slots * strip_rows * stored_row / (1024.0 * 1024.0);
+    double table_mb = (double)(planes.size() * row_bytes + maskY.size() * sizeof(uint32_t)) / (1024.0 * 1024.0);
+
+    cout << "Image size: " << size << "x" << size << " (" << megapixels << " Mpx)" << endl;
+    cout << "Strips: " << num_strips << " x " << strip_rows << " rows, threads: " << num_threads << endl;
+    cout << "Strip buffers: " << buffer_mb << " MB, row tables: " << table_mb << " MB" << endl;
+    if (format == Format::PNG)
+        cout << "Compressed image data: " << compressed_bytes / (1024.0 * 1024.0) << " MB" << endl;
+    cout << "Rendering time: " << seconds * 1000 << " ms" << endl;
+    cout << "Throughput: " << megapixels / seconds << " Mpx/s" << endl;
+
+    return 0;
+}
@@ -0,0 +1,322 @@
+﻿#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+#include <omp.h>
+
+using namespace std;
+using namespace cv;
+
+// Цвета (как в Sierpinski Carpet.cpp)
+const Scalar BACKGROUND_COLOR = Scalar(255, 255, 255); // белый
+const Scalar CARPET_COLOR = Scalar(255, 0, 0);         // синий
+
+// Аффинное отображение x' = a*x + b*y + e, y' = c*x + d*y + f
+struct AffineMap {
+    double a, b, c, d, e, f;
+    double p; // вероятность выбора в игре в хаос
+
+    Point2d apply(const Point2d& pt) const {
+        return Point2d(a * pt.x + b * pt.y + e, c * pt.x + d * pt.y + f);
+    }
+
+    // Композиция this(other(x))
+    AffineMap compose(const AffineMap& other) const {
+        return { a * other.a + b * other.c, a * other.b + b * other.d,
+                 c * other.a + d * other.c, c * other.b + d * other.d,
+                 a * other.e + b * other.f + e, c * other.e + d * other.f + f, p };
+    }
+};
+
+// Система итерированных функций и окно мировых координат, которое она заполняет
+struct IFS {
+    vector<AffineMap> maps;
+    double xmin = 0, ymin = 0, xmax = 1, ymax = 1;
+};
+
+// Формат файла: строки "window xmin ymin xmax ymax" и "map a b c d e f [p]", '#' - комментарий.
+// Если вероятности не заданы, они пропорциональны |det| (с нижней границей для вырожденных отображений)
+bool loadIFS(const string& path, IFS& ifs) {
+    ifstream file(path);
+    if (!file.is_open())
+        return false;
+
+    bool has_probabilities = true;
+    string line;
+    while (getline(file, line)) {
+        size_t comment = line.find('#');
+        if (comment != string::npos)
+            line = line.substr(0, comment);
+
+        istringstream in(line);
+        string keyword;
+        if (!(in >> keyword))
+            continue;
+
+        if (keyword == "window") {
+            in >> ifs.xmin >> ifs.ymin >> ifs.xmax >> ifs.ymax;
+        }
+        else if (keyword == "map") {
+            AffineMap m;
+            in >> m.a >> m.b >> m.c >> m.d >> m.e >> m.f;
+            if (!in)
+                return false;
+            if (!(in >> m.p)) {
+                m.p = 0;
+                has_probabilities = false;
+            }
+            ifs.maps.push_back(m);
+        }
+        else {
+            return false;
+        }
+    }
+
+    if (ifs.maps.empty() || ifs.xmax <= ifs.xmin || ifs.ymax <= ifs.ymin)
+        return false;
+
+    if (!has_probabilities) {
+        for (auto& m : ifs.maps)
+            m.p = max(abs(m.a * m.d - m.b * m.c), 0.01);
+    }
+    double total = 0;
+    for (const auto& m : ifs.maps)
+        total += m.p;
+    for (auto& m : ifs.maps)
+        m.p /= total;
+    return true;
+}
+
+// Перевод мировых координат в пиксели (ось y направлена вверх)
+struct Viewport {
+    double sx, sy, xmin, ymax;
+
+    Viewport(const IFS& ifs, int width, int height)
+        : sx(width / (ifs.xmax - ifs.xmin)), sy(height / (ifs.ymax - ifs.ymin)), xmin(ifs.xmin), ymax(ifs.ymax) {}
+
+    Point2d toPixel(const Point2d& pt) const {
+        return Point2d((pt.x - xmin) * sx, (ymax - pt.y) * sy);
+    }
+};
+
+// ---------- Детерминированный backend: рекурсивное деление ----------
+// Обобщение drawCarpet: вместо подквадратов 3x3 берутся образы окна под композициями
+// отображений. Рекурсия останавливается на заданной глубине или когда образ меньше пикселя.
+// Каждый поток рисует свою горизонтальную полосу и отбрасывает ветви, не задевающие её,
+// поэтому потоки не пишут в одни и те же пиксели.
+
+struct SubdivisionContext {
+    const IFS* ifs;
+    Viewport view;
+    Mat band;     // полоса изображения, принадлежащая потоку
+    int band_y0;  // её первая строка в изображении
+    int max_depth;
+    long long leaves;
+};
+
+void subdivide(SubdivisionContext& ctx, const AffineMap& transform, int depth) {
+    const IFS& ifs = *ctx.ifs;
+    Point2d corners[4] = {
+        ctx.view.toPixel(transform.apply(Point2d(ifs.xmin, ifs.ymin))),
+        ctx.view.toPixel(transform.apply(Point2d(ifs.xmax, ifs.ymin))),
+        ctx.view.toPixel(transform.apply(Point2d(ifs.xmax, ifs.ymax))),
+        ctx.view.toPixel(transform.apply(Point2d(ifs.xmin, ifs.ymax))),
+    };
+
+    double top = corners[0].y, bottom = corners[0].y, left = corners[0].x, right = corners[0].x;
+    for (int i = 1; i < 4; ++i) {
+        top = min(top, corners[i].y);
+        bottom = max(bottom, corners[i].y);
+        left = min(left, corners[i].x);
+        right = max(right, corners[i].x);
+    }
+
+    // Ветвь не задевает полосу потока
+    if (bottom < ctx.band_y0 || top >= ctx.band_y0 + ctx.band.rows || right < 0 || left >= ctx.band.cols)
+        return;
+
+    // Образ меньше пикселя - дальше делить бессмысленно
+    if (right - left < 1.0 && bottom - top < 1.0) {
+        int x = (int)((left + right) / 2);
+        int y = (int)((top + bottom) / 2) - ctx.band_y0;
+        if (x >= 0 && x < ctx.band.cols && y >= 0 && y < ctx.band.rows)
+            ctx.band.at<Vec3b>(y, x) = Vec3b((uchar)CARPET_COLOR[0], (uchar)CARPET_COLOR[1], (uchar)CARPET_COLOR[2]);
+        ++ctx.leaves;
+        return;
+    }
+
+    if (depth == ctx.max_depth) {
+        // Координаты с 8 битами дробной части
+        const int shift = 8;
+        Point poly[4];
+        for (int i = 0; i < 4; ++i)
+            poly[i] = Point((int)lround(corners[i].x * (1 << shift)),
+                (int)lround((corners[i].y - ctx.band_y0) * (1 << shift)));
+        fillConvexPoly(ctx.band, poly, 4, CARPET_COLOR, LINE_8, shift);
+        ++ctx.leaves;
+        return;
+    }
+
+    for (const auto& m : ifs.maps)
+        subdivide(ctx, transform.compose(m), depth + 1);
+}
+
+long long renderSubdivision(const IFS& ifs, Mat& image, int max_depth) {
+    const int num_bands = 4 * omp_get_max_threads();
+    const int band_height = (image.rows + num_bands - 1) / num_bands;
+    const AffineMap identity = { 1, 0, 0, 1, 0, 0, 1 };
+    long long leaves = 0;
+
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : leaves)
+    for (int b = 0; b < num_bands; ++b) {
+        int y0 = b * band_height;
+        int y1 = min(image.rows, y0 + band_height);
+        if (y0 >= y1)
+            continue;
+
+        SubdivisionContext ctx = { &ifs, Viewport(ifs, image.cols, image.rows), image.rowRange(y0, y1), y0, max_depth, 0 };
+        subdivide(ctx, identity, 0);
+        leaves += ctx.leaves;
+    }
+    return leaves;
+}
+
+// ---------- Игра в хаос: накопление плотности ----------
+
+// Счётчиковый генератор: число зависит только от ключа и номера шага (финализатор SplitMix64),
+// поэтому цепочки не хранят состояние и результат не зависит от числа потоков
+inline uint64_t counterRandom(uint64_t key, uint64_t counter) {
+    uint64_t z = key + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Гистограмма попаданий. Точки разбиты на фиксированное число цепочек,
+// каждый поток копит свою гистограмму, в конце гистограммы складываются
+vector<uint32_t> renderChaosGame(const IFS& ifs, int width, int height, long long points, uint64_t seed) {
+    const int num_chains = 1024;
+    const int warmup = 20;
+    const long long per_chain = (points + num_chains - 1) / num_chains;
+    const Viewport view(ifs, width, height);
+    const size_t pixels = (size_t)width * height;
+
+    // Накопленные вероятности для выбора отображения
+    vector<double> cumulative;
+    double acc = 0;
+    for (const auto& m : ifs.maps)
+        cumulative.push_back(acc += m.p);
+    cumulative.back() = 1.0;
+
+    const int num_threads = omp_get_max_threads();
+    vector<vector<uint32_t>> local(num_threads);
+
+#pragma omp parallel
+    {
+        vector<uint32_t>& hist = local[omp_get_thread_num()];
+        hist.assign(pixels, 0);
+
+#pragma omp for schedule(dynamic, 4)
+        for (int chain = 0; chain < num_chains; ++chain) {
+            uint64_t key = counterRandom(seed, chain);
+            Point2d pt((ifs.xmin + ifs.xmax) / 2, (ifs.ymin + ifs.ymax) / 2);
+
+            for (long long i = 0; i < per_chain + warmup; ++i) {
+                double r = (counterRandom(key, i) >> 11) * (1.0 / 9007199254740992.0);
+                size_t k = 0;
+                while (k + 1 < cumulative.size() && r >= cumulative[k])
+                    ++k;
+                pt = ifs.maps[k].apply(pt);
+
+                if (i < warmup)
+                    continue;
+                Point2d px = view.toPixel(pt);
+                if (px.x >= 0 && px.x < width && px.y >= 0 && px.y < height)
+                    ++hist[(size_t)px.y * width + (size_t)px.x];
+            }
+        }
+    }
+
+    // Слияние гистограмм потоков, параллельно по пикселям
+    vector<uint32_t> density(pixels, 0);
+#pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)pixels; ++i) {
+        uint32_t sum = 0;
+        for (int t = 0; t < num_threads; ++t)
+            if (!local[t].empty())
+                sum += local[t][i];
+        density[i] = sum;
+    }
+    return density;
+}
+
+// Логарифмическая шкала плотности: от цвета фона к цвету ковра
+void densityToImage(const vector<uint32_t>& density, Mat& image) {
+    uint32_t max_count = *max_element(density.begin(), density.end());
+    double norm_factor = max_count > 0 ? 1.0 / log1p((double)max_count) : 0.0;
+
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < image.rows; ++y) {
+        Vec3b* row = image.ptr<Vec3b>(y);
+        for (int x = 0; x < image.cols; ++x) {
+            double t = log1p((double)density[(size_t)y * image.cols + x]) * norm_factor;
+            for (int c = 0; c < 3; ++c)
+                row[x][c] = saturate_cast<uchar>(BACKGROUND_COLOR[c] + t * (CARPET_COLOR[c] - BACKGROUND_COLOR[c]));
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Usage: " << argv[0] << " <config.ifs> [recursive|chaos] [size] [depth|points]" << endl;
+        return -1;
+    }
+
+    IFS ifs;
+    if (!loadIFS(argv[1], ifs)) {
+        cout << "Error: failed to load IFS config " << argv[1] << endl;
+        return -1;
+    }
+
+    string backend = argc > 2 ? argv[2] : "recursive";
+    int size = argc > 3 ? atoi(argv[3]) : 729;
+    if (size < 1) {
+        cout << "Invalid image size!" << endl;
+        return -1;
+    }
+
+    Mat image(size, size, CV_8UC3, BACKGROUND_COLOR);
+    double start = omp_get_wtime();
+
+    if (backend == "recursive") {
+        // По умолчанию делим до размера пикселя
+        int depth = argc > 4 ? atoi(argv[4]) : 64;
+        long long leaves = renderSubdivision(ifs, image, depth);
+        cout << "Leaves drawn: " << leaves << endl;
+    }
+    else if (backend == "chaos") {
+        long long points = argc > 4 ? atoll(argv[4]) : 50000000LL;
+        vector<uint32_t> density = renderChaosGame(ifs, size, size, points, 12345);
+        densityToImage(density, image);
+        cout << "Points: " << points << endl;
+    }
+    else {
+        cout << "Unknown backend: " << backend << endl;
+        return -1;
+    }
+
+    double end = omp_get_wtime();
+    cout << "Maps: " << ifs.maps.size() << ", backend: " << backend << ", threads: " << omp_get_max_threads() << endl;
+    cout << "Rendering time: " << (end - start) * 1000 << " ms" << endl;
+
+    imwrite("ifs_result.png", image);
+    imshow("IFS Fractal", image);
+    waitKey(0);
+
+    return 0;
+}
@@ -1,6 +1,7 @@
 ﻿#include <iostream>
 #include <opencv2/opencv.hpp>
 #include <omp.h>
+#include "Carpet Kernel.h"
 
 using namespace std;
 using namespace cv;
@@ -37,6 +38,56 @@ void drawCarpet(Mat& image, int x, int y, int size, int depth) {
     }
 }
 
+// Прямое вычисление ковра: пиксель (x, y) - дыра, если на каком-то уровне
+// обе троичные цифры координат равны 1, то есть маски x и y пересекаются
+void drawCarpetDirect(Mat& image, int depth) {
+    vector<uint32_t> mask = buildDigitMask(image.cols, depth);
+    const uint32_t* maskX = mask.data();
+    const Vec3b carpet(saturate_cast<uchar>(CARPET_COLOR[0]), saturate_cast<uchar>(CARPET_COLOR[1]),
+        saturate_cast<uchar>(CARPET_COLOR[2]));
+    const Vec3b background(saturate_cast<uchar>(BACKGROUND_COLOR[0]), saturate_cast<uchar>(BACKGROUND_COLOR[1]),
+        saturate_cast<uchar>(BACKGROUND_COLOR[2]));
+    const int cols = image.cols;
+
+    // Строки независимы - одна параллельная область на всё изображение
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < image.rows; ++y) {
+        const uint32_t maskY = mask[y];
+        uchar* row = image.ptr<uchar>(y);
+
+        // Векторизация по пикселям строки
+#pragma omp simd
+        for (int x = 0; x < cols; ++x) {
+            bool hole = (maskX[x] & maskY) != 0;
+            row[3 * x + 0] = hole ? background[0] : carpet[0];
+            row[3 * x + 1] = hole ? background[1] : carpet[1];
+            row[3 * x + 2] = hole ? background[2] : carpet[2];
+        }
+    }
+}
+
+// Сравнение с рекурсивным рисованием для всех допустимых глубин.
+// drawCarpet рисует квадраты включительно по правой и нижней границе, и соседние
+// подквадраты верхнего уровня гоняются за общие пиксели, поэтому эталон строится в один поток
+bool verifyDirectRenderer() {
+    int threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+
+    bool equal = true;
+    for (int depth = 1; depth <= 7 && equal; ++depth) {
+        Mat reference(SIZE, SIZE, CV_8UC3, BACKGROUND_COLOR);
+        drawCarpet(reference, 0, 0, SIZE, depth);
+
+        Mat direct(SIZE, SIZE, CV_8UC3);
+        drawCarpetDirect(direct, depth);
+
+        equal = norm(reference, direct, NORM_INF) == 0;
+    }
+
+    omp_set_num_threads(threads);
+    return equal;
+}
+
 int main() {
     int depth;
     cout << "Enter recursion depth (1-7): "; //Порядок рекурсии
@@ -60,8 +111,17 @@ int main() {
     double end = omp_get_wtime();
     cout << "Rendering time: " << (end - start) * 1000 << " ms" << endl;
 
+    // Прямое вычисление по троичным цифрам
+    Mat direct(SIZE, SIZE, CV_8UC3);
+    double start_direct = omp_get_wtime();
+    drawCarpetDirect(direct, depth);
+    double end_direct = omp_get_wtime();
+    cout << "Direct rendering time: " << (end_direct - start_direct) * 1000 << " ms" << endl;
+    cout << "Speedup: " << (end - start) / (end_direct - start_direct) << "x" << endl;
+    cout << "Direct renderer matches recursive (depths 1-7): " << (verifyDirectRenderer() ? "yes" : "no") << endl;
+
     // Показываем изображение
-    imshow("Sierpinski Carpet", image);
+    imshow("Sierpinski Carpet", direct);
     waitKey(0);
 
     return 0;
@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Haar Common.h"
+
+// Параллельная обработка кадров: несколько кадров одного видео обрабатываются одновременно,
+// каждый рабочий поток использует свой набор каскадов. Буфер переупорядочивания отдаёт
+// готовые кадры строго в исходном порядке.
+
+struct FrameJob {
+    long index = 0;
+    cv::Mat img;
+    Detections det;
+};
+
+// Буфер переупорядочивания с окном: декодер не может уйти вперёд записи больше чем на window
+// кадров, поэтому число кадров в памяти ограничено независимо от скорости потоков
+class ReorderBuffer {
+public:
+    explicit ReorderBuffer(long window) : window(window) {}
+
+    // Декодер: ждёт, пока кадр index попадёт в окно
+    void reserve(long index) {
+        std::unique_lock<std::mutex> lock(mtx);
+        window_moved.wait(lock, [&] { return index < next_out + window; });
+    }
+
+    // Рабочий поток: готовый кадр
+    void put(FrameJob job) {
+        std::lock_guard<std::mutex> lock(mtx);
+        ready.emplace(job.index, std::move(job));
+        frame_ready.notify_all();
+    }
+
+    // Потребитель: следующий по порядку кадр; false, если кадров больше не будет
+    bool take(FrameJob& job) {
+        std::unique_lock<std::mutex> lock(mtx);
+        frame_ready.wait(lock, [&] { return ready.count(next_out) || next_out >= total; });
+        auto it = ready.find(next_out);
+        if (it == ready.end())
+            return false;
+        job = std::move(it->second);
+        ready.erase(it);
+        ++next_out;
+        window_moved.notify_all();
+        return true;
+    }
+
+    // Декодер: общее число кадров известно после конца видео
+    void finish(long frames) {
+        std::lock_guard<std::mutex> lock(mtx);
+        total = frames;
+        frame_ready.notify_all();
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable frame_ready, window_moved;
+    std::map<long, FrameJob> ready;
+    long next_out = 0;
+    long total = LONG_MAX;
+    long window;
+};
+
+// Обработка видео workers рабочими потоками, поток w использует sets[w]. on_frame(job)
+// вызывается в вызывающем потоке для каждого кадра в исходном порядке.
+// annotate = true рисует рамки в рабочих потоках. Возвращает число обработанных кадров
+template <typename Callback>
+long processFramesParallel(cv::VideoCapture& cap, CascadeSet* sets, int workers, bool annotate, Callback on_frame) {
+    BoundedQueue<FrameJob> decoded(2 * workers);
+    ReorderBuffer reorder(4 * workers);
+
+    std::thread decoder([&] {
+        long index = 0;
+        while (true) {
+            reorder.reserve(index);
+            FrameJob job;
+            cap >> job.img;
+            if (job.img.empty())
+                break;
+            job.index = index++;
+            decoded.push(std::move(job));
+        }
+        decoded.close();
+        reorder.finish(index);
+    });
+
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; ++w)
+        pool.emplace_back([&, w] {
+            cv::Mat gray;
+            FrameJob job;
+            while (decoded.pop(job)) {
+                prepareGray(job.img, gray);
+                // Параллелизм уже на уровне кадров, поэтому каскады внутри кадра идут последовательно
+                detectFullFrame(sets[w], gray, job.det, false);
+                filterByFaces(job.det);
+                if (annotate)
+                    drawDetections(job.img, job.det);
+                reorder.put(std::move(job));
+            }
+        });
+
+    long frames = 0;
+    FrameJob job;
+    while (reorder.take(job)) {
+        on_frame(job);
+        ++frames;
+    }
+
+    decoder.join();
+    for (auto& th : pool)
+        th.join();
+    return frames;
+}
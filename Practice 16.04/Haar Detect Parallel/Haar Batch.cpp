@@ -0,0 +1,299 @@
+﻿#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <set>
+#include "Haar Common.h"
+#include "Frame Parallel.h"
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+namespace fs = std::filesystem;
+
+// Пакетная обработка без окна: много видео одновременно в рамках общего бюджета потоков.
+//   Haar Batch [--threads N] [--annotate] [--format csv|jsonl] [--out DIR] <video|dir|@list.txt>...
+// Для каждого видео пишется файл обнаружений по кадрам и, с --annotate, видео с рамками.
+// --threads - всего потоков, включая декодеры и потоки записи результатов.
+// Имена выходных файлов - имя видео с расширением (a.mp4 -> a_mp4.csv); если два входа всё
+// равно совпадают (x/a.mp4 и y/a.mp4), к имени добавляется номер видео в списке.
+
+// Потоки слота помимо рабочих: декодер в processFramesParallel и поток слота, который пишет результаты
+const int SLOT_SERVICE_THREADS = 2;
+
+struct BatchOptions {
+    int threads = (int)thread::hardware_concurrency();
+    bool annotate = false;
+    bool jsonl = false;
+    string out_dir = "results";
+    vector<string> videos;
+};
+
+struct VideoResult {
+    string path;
+    long frames = 0;
+    double ms = 0;
+    int workers = 0;
+    bool ok = false;
+    string error;
+};
+
+bool isVideoFile(const fs::path& p) {
+    string ext = p.extension().string();
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".mp4" || ext == ".avi" || ext == ".mov" || ext == ".mkv" || ext == ".webm";
+}
+
+// Аргумент может быть видеофайлом, каталогом с видео или @файлом со списком путей.
+// Строки списка обрезаются с обоих концов, так что файлы с концами строк CRLF тоже читаются
+bool collectVideos(const string& arg, vector<string>& videos, string& error) {
+    if (!arg.empty() && arg[0] == '@') {
+        ifstream list(arg.substr(1));
+        if (!list.is_open()) {
+            error = "cannot read video list " + arg.substr(1);
+            return false;
+        }
+        string line;
+        while (getline(list, line)) {
+            const size_t first = line.find_first_not_of(" \t\r");
+            if (first == string::npos)
+                continue;
+            const size_t last = line.find_last_not_of(" \t\r");
+            videos.push_back(line.substr(first, last - first + 1));
+        }
+        if (list.bad()) {
+            error = "error reading video list " + arg.substr(1);
+            return false;
+        }
+        return true;
+    }
+
+    if (fs::is_directory(arg)) {
+        vector<string> found;
+        for (const auto& entry : fs::directory_iterator(arg))
+            if (entry.is_regular_file() && isVideoFile(entry.path()))
+                found.push_back(entry.path().string());
+        sort(found.begin(), found.end());
+        videos.insert(videos.end(), found.begin(), found.end());
+        return true;
+    }
+
+    videos.push_back(arg);
+    return true;
+}
+
+// Уникальные имена выходных файлов для всех видео: видео обрабатываются одновременно,
+// и два писателя в один файл испортили бы оба результата
+vector<string> outputNames(const vector<string>& videos) {
+    vector<string> names;
+    set<string> taken;
+    for (size_t v = 0; v < videos.size(); ++v) {
+        fs::path p(videos[v]);
+        string ext = p.extension().string();
+        const string base = p.stem().string() + (ext.size() > 1 ? "_" + ext.substr(1) : "");
+        string name = base;
+        // При совпадении - номер видео в списке, а если занят и такой - ещё счётчик
+        for (int suffix = 1; taken.count(name); ++suffix)
+            name = base + "_" + to_string(v + 1) + (suffix > 1 ? "_" + to_string(suffix) : "");
+        taken.insert(name);
+        names.push_back(name);
+    }
+    return names;
+}
+
+// false - неверные аргументы; error непуст, если не прочитался список видео
+bool parseArgs(int argc, char* argv[], BatchOptions& opt, string& error) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            opt.threads = atoi(argv[++i]);
+        else if (arg == "--annotate")
+            opt.annotate = true;
+        else if (arg == "--format" && i + 1 < argc) {
+            string format = argv[++i];
+            if (format != "csv" && format != "jsonl")
+                return false;
+            opt.jsonl = format == "jsonl";
+        }
+        else if (arg == "--out" && i + 1 < argc)
+            opt.out_dir = argv[++i];
+        else if (arg.size() > 2 && arg.substr(0, 2) == "--")
+            return false;
+        else if (!collectVideos(arg, opt.videos, error))
+            return false;
+    }
+    if (opt.threads < 1)
+        opt.threads = 1;
+    return !opt.videos.empty();
+}
+
+void writeRects(ostream& out, const vector<Rect>& rects) {
+    out << "[";
+    for (size_t i = 0; i < rects.size(); ++i) {
+        const Rect& r = rects[i];
+        out << (i ? "," : "") << "[" << r.x << "," << r.y << "," << r.width << "," << r.height << "]";
+    }
+    out << "]";
+}
+
+// Одна строка JSON на кадр или строка CSV на каждый найденный объект
+void writeDetections(ostream& out, long frame, const Detections& det, bool jsonl) {
+    if (jsonl) {
+        out << "{\"frame\":" << frame << ",\"faces\":";
+        writeRects(out, det.faces);
+        out << ",\"eyes\":";
+        writeRects(out, det.eyes);
+        out << ",\"smiles\":";
+        writeRects(out, det.smiles);
+        out << "}\n";
+        return;
+    }
+
+    const pair<const char*, const vector<Rect>*> kinds[] = { { "face", &det.faces }, { "eye", &det.eyes }, { "smile", &det.smiles } };
+    for (const auto& kind : kinds)
+        for (const auto& r : *kind.second)
+            out << frame << "," << kind.first << "," << r.x << "," << r.y << "," << r.width << "," << r.height << "\n";
+}
+
+VideoResult processVideo(const string& path, const string& name, CascadeSet* sets, int workers, const BatchOptions& opt) {
+    VideoResult result;
+    result.path = path;
+    result.workers = workers;
+
+    VideoCapture cap(path);
+    if (!cap.isOpened()) {
+        result.error = "failed to open";
+        return result;
+    }
+
+    const fs::path detections_path = fs::path(opt.out_dir) / (name + (opt.jsonl ? ".jsonl" : ".csv"));
+    ofstream detections(detections_path);
+    if (!detections.is_open()) {
+        result.error = "cannot write " + detections_path.string();
+        return result;
+    }
+    if (!opt.jsonl)
+        detections << "frame,type,x,y,width,height\n";
+
+    VideoWriter writer;
+    if (opt.annotate) {
+        Size frameSize(static_cast<int>(cap.get(CAP_PROP_FRAME_WIDTH)), static_cast<int>(cap.get(CAP_PROP_FRAME_HEIGHT)));
+        double fps = cap.get(CAP_PROP_FPS);
+        const fs::path video_path = fs::path(opt.out_dir) / (name + "_annotated.mp4");
+        writer.open(video_path.string(), VideoWriter::fourcc('a', 'v', 'c', '1'), fps > 0 ? fps : 30, frameSize, true);
+        if (!writer.isOpened()) {
+            result.error = "cannot write " + video_path.string() + " (avc1 codec unavailable or path not writable)";
+            return result;
+        }
+    }
+
+    auto start = steady_clock::now();
+    result.frames = processFramesParallel(cap, sets, workers, opt.annotate, [&](FrameJob& job) {
+        writeDetections(detections, job.index, job.det, opt.jsonl);
+        if (opt.annotate)
+            writer.write(job.img);
+    });
+    result.ms = elapsedMs(start, steady_clock::now());
+
+    // Ошибка записи (например, кончилось место) видна только по состоянию потока
+    detections.flush();
+    if (!detections) {
+        result.error = "error writing " + detections_path.string();
+        return result;
+    }
+    result.ok = true;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    BatchOptions opt;
+    string error;
+    if (!parseArgs(argc, argv, opt, error)) {
+        if (!error.empty()) {
+            cerr << "Error: " << error << endl;
+            return -1;
+        }
+        cerr << "Usage: " << argv[0] << " [--threads N] [--annotate] [--format csv|jsonl] [--out DIR] <video|dir|@list.txt>..." << endl;
+        return -1;
+    }
+
+    // Бюджет потоков делится между видео, внутренний пул OpenCV его бы превышал
+    setNumThreads(1);
+    fs::create_directories(opt.out_dir);
+
+    // Видео обрабатываются в slots слотах одновременно, потоки бюджета делятся между слотами
+    // поровну. Кроме рабочих потоков слот занимает поток декодера и поток, пишущий результаты,
+    // поэтому на детектор остаётся share - SLOT_SERVICE_THREADS, но не меньше одного
+    const int slots = max(1, min(opt.threads / (SLOT_SERVICE_THREADS + 1), (int)opt.videos.size()));
+    vector<int> share(slots, opt.threads / slots);
+    for (int s = 0; s < opt.threads % slots; ++s)
+        ++share[s];
+    int used_threads = 0;
+    for (int s = 0; s < slots; ++s) {
+        share[s] = max(1, share[s] - SLOT_SERVICE_THREADS);
+        used_threads += share[s] + SLOT_SERVICE_THREADS;
+    }
+
+    // Наборы каскадов загружаются один раз на рабочий поток и переиспользуются для всех видео слота
+    vector<vector<CascadeSet>> slot_sets(slots);
+    for (int s = 0; s < slots; ++s)
+        if (!loadCascadeSets(slot_sets[s], share[s], error)) {
+            cerr << "Error: " << error << endl;
+            return -1;
+        }
+
+    const vector<string> names = outputNames(opt.videos);
+    vector<VideoResult> results(opt.videos.size());
+    atomic<size_t> next_video(0);
+    mutex print_mtx;
+
+    auto start = steady_clock::now();
+
+    vector<thread> slot_threads;
+    for (int s = 0; s < slots; ++s)
+        slot_threads.emplace_back([&, s] {
+            for (size_t v = next_video++; v < opt.videos.size(); v = next_video++) {
+                results[v] = processVideo(opt.videos[v], names[v], slot_sets[s].data(), share[s], opt);
+
+                lock_guard<mutex> lock(print_mtx);
+                const VideoResult& r = results[v];
+                if (r.ok)
+                    printf("[%zu/%zu] %s: %ld frames, %.1f FPS (%d workers)\n", v + 1, opt.videos.size(), r.path.c_str(),
+                        r.frames, r.ms > 0 ? r.frames * 1000.0 / r.ms : 0.0, r.workers);
+                else
+                    printf("[%zu/%zu] %s: %s\n", v + 1, opt.videos.size(), r.path.c_str(), r.error.c_str());
+                fflush(stdout);
+            }
+        });
+
+    for (auto& th : slot_threads)
+        th.join();
+
+    double wall_ms = elapsedMs(start, steady_clock::now());
+
+    long total_frames = 0;
+    int failed = 0;
+    for (const auto& r : results) {
+        total_frames += r.frames;
+        if (!r.ok)
+            ++failed;
+    }
+
+    cout << "\nVideos: " << opt.videos.size() << " (" << failed << " failed), thread budget: " << opt.threads
+         << ", threads used: " << used_threads << ", concurrent videos: " << slots << endl;
+    cout << "Total frames: " << total_frames << endl;
+    cout << "Total time: " << wall_ms << " ms" << endl;
+    cout << "Aggregate FPS: " << (wall_ms > 0 ? total_frames * 1000.0 / wall_ms : 0.0) << endl;
+    cout << "Results written to " << opt.out_dir << endl;
+
+    return failed ? 1 : 0;
+}
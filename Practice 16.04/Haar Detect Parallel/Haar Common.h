@@ -0,0 +1,255 @@
+﻿#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <omp.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Общие части программ обнаружения лиц: загрузка каскадов, обнаружение с параметрами
+// из Haar Detect Parallel.cpp, фильтрация по лицам, рисование и очередь между потоками
+
+// Параметры detectMultiScale для одного каскада
+struct CascadeParams {
+    double scale_factor;
+    int min_neighbors;
+    cv::Size min_size;
+};
+
+const CascadeParams FACE_PARAMS = { 1.1, 5, cv::Size(50, 50) };
+const CascadeParams EYE_PARAMS = { 1.2, 10, cv::Size(50, 50) };
+const CascadeParams SMILE_PARAMS = { 1.2, 50, cv::Size(40, 20) };
+
+// Набор каскадов Хаара. CascadeClassifier нельзя использовать из нескольких потоков
+// одновременно, поэтому параллельным программам нужен отдельный набор на поток
+struct CascadeSet {
+    cv::CascadeClassifier face;
+    cv::CascadeClassifier eye;
+    cv::CascadeClassifier smile;
+
+    bool load(std::string& error) {
+        if (!face.load("haarcascade_frontalface_default.xml")) {
+            error = "Failed to load face classifier!";
+            return false;
+        }
+        if (!eye.load("haarcascade_eye.xml")) {
+            error = "Failed to load eye classifier!";
+            return false;
+        }
+        if (!smile.load("haarcascade_smile.xml")) {
+            error = "Failed to load smile classifier!";
+            return false;
+        }
+        return true;
+    }
+};
+
+// Загрузка count независимых наборов каскадов
+inline bool loadCascadeSets(std::vector<CascadeSet>& sets, int count, std::string& error) {
+    sets = std::vector<CascadeSet>(count);
+    for (auto& set : sets)
+        if (!set.load(error))
+            return false;
+    return true;
+}
+
+struct Detections {
+    std::vector<cv::Rect> faces, eyes, smiles;
+};
+
+// Преобразование в оттенки серого и улучшение контраста
+inline void prepareGray(const cv::Mat& img, cv::Mat& gray) {
+    cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+    cv::equalizeHist(gray, gray);
+}
+
+inline void detectWith(cv::CascadeClassifier& cascade, const cv::Mat& gray, std::vector<cv::Rect>& found,
+    const CascadeParams& params) {
+    cascade.detectMultiScale(gray, found, params.scale_factor, params.min_neighbors, 0, params.min_size);
+}
+
+// Обнаружение на всём кадре, как в основном цикле Haar Detect Parallel.cpp.
+// parallel = false нужен, когда вызывающий код сам распределяет кадры по потокам
+inline void detectFullFrame(CascadeSet& set, const cv::Mat& gray, Detections& det, bool parallel = true) {
+#pragma omp parallel sections if (parallel)
+    {
+#pragma omp section
+        {
+            detectWith(set.face, gray, det.faces, FACE_PARAMS);
+        }
+
+#pragma omp section
+        {
+            detectWith(set.eye, gray, det.eyes, EYE_PARAMS);
+        }
+
+#pragma omp section
+        {
+            detectWith(set.smile, gray, det.smiles, SMILE_PARAMS);
+        }
+    }
+}
+
+// Оставляет только глаза и улыбки, левый верхний угол которых лежит внутри какого-либо лица
+inline void filterByFaces(Detections& det) {
+    auto inside_face = [&](const cv::Rect& r) {
+        cv::Point xy(r.x, r.y);
+        for (const auto& face : det.faces)
+            if (face.contains(xy))
+                return true;
+        return false;
+    };
+
+    std::vector<cv::Rect> eyes, smiles;
+    for (const auto& r : det.eyes)
+        if (inside_face(r))
+            eyes.push_back(r);
+    for (const auto& r : det.smiles)
+        if (inside_face(r))
+            smiles.push_back(r);
+    det.eyes.swap(eyes);
+    det.smiles.swap(smiles);
+}
+
+// Лица ищутся на всём кадре, затем глаза - только в верхней половине каждого лица,
+// а улыбки - в нижней. Задачи по лицам выполняются параллельно, каждый поток берёт
+// свой набор каскадов из sets. Результаты возвращаются в координатах кадра
+inline void detectInFaceROIs(std::vector<CascadeSet>& sets, const cv::Mat& gray, Detections& det) {
+    detectWith(sets[0].face, gray, det.faces, FACE_PARAMS);
+
+    const int jobs = 2 * (int)det.faces.size();
+    std::vector<std::vector<cv::Rect>> found(jobs);
+    const cv::Rect frame(0, 0, gray.cols, gray.rows);
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads((int)sets.size())
+    for (int j = 0; j < jobs; ++j) {
+        CascadeSet& set = sets[omp_get_thread_num()];
+        const cv::Rect& face = det.faces[j / 2];
+        bool eye_job = j % 2 == 0;
+
+        cv::Rect roi = eye_job ? cv::Rect(face.x, face.y, face.width, face.height / 2)
+                               : cv::Rect(face.x, face.y + face.height / 2, face.width, face.height - face.height / 2);
+        roi &= frame;
+        if (roi.empty())
+            continue;
+
+        if (eye_job)
+            detectWith(set.eye, gray(roi), found[j], EYE_PARAMS);
+        else
+            detectWith(set.smile, gray(roi), found[j], SMILE_PARAMS);
+
+        for (auto& r : found[j]) {
+            r.x += roi.x;
+            r.y += roi.y;
+        }
+    }
+
+    det.eyes.clear();
+    det.smiles.clear();
+    for (int j = 0; j < jobs; ++j) {
+        auto& target = j % 2 == 0 ? det.eyes : det.smiles;
+        target.insert(target.end(), found[j].begin(), found[j].end());
+    }
+}
+
+inline void drawDetections(cv::Mat& img, const Detections& det) {
+    for (const auto& r : det.faces)
+        cv::rectangle(img, r, cv::Scalar(255, 0, 0), 2);
+    for (const auto& r : det.eyes)
+        cv::rectangle(img, r, cv::Scalar(0, 0, 255), 2);
+    for (const auto& r : det.smiles)
+        cv::rectangle(img, r, cv::Scalar(0, 255, 0), 2);
+}
+
+// Ограниченная очередь между стадиями. push блокируется, пока очередь заполнена
+// (обратное давление на предыдущую стадию), pop возвращает false после close()
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(T value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_full.wait(lock, [this] { return items.size() < capacity; });
+        items.push_back(std::move(value));
+        not_empty.notify_one();
+    }
+
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_empty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty())
+            return false;
+        value = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        not_empty.notify_all();
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable not_full, not_empty;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+};
+
+inline double elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Доля площади пересечения от площади объединения
+inline double iou(const cv::Rect& a, const cv::Rect& b) {
+    double inter = (a & b).area();
+    double uni = (double)a.area() + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.0;
+}
+
+// Число пар с IoU >= threshold при жадном сопоставлении
+inline int matchDetections(const std::vector<cv::Rect>& a, const std::vector<cv::Rect>& b, double threshold = 0.5) {
+    std::vector<bool> used(b.size(), false);
+    int matched = 0;
+    for (const auto& r : a) {
+        int best = -1;
+        double best_iou = threshold;
+        for (size_t j = 0; j < b.size(); ++j) {
+            double v = iou(r, b[j]);
+            if (!used[j] && v >= best_iou) {
+                best_iou = v;
+                best = (int)j;
+            }
+        }
+        if (best >= 0) {
+            used[best] = true;
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+// Счётчики совпадения эталонных и проверяемых обнаружений одного типа объектов
+struct Agreement {
+    long reference = 0;
+    long candidate = 0;
+    long matched = 0;
+
+    void add(const std::vector<cv::Rect>& ref, const std::vector<cv::Rect>& cand) {
+        reference += (long)ref.size();
+        candidate += (long)cand.size();
+        matched += matchDetections(ref, cand);
+    }
+
+    // F1-мера совпадения: 1 - наборы совпадают полностью
+    double score() const {
+        return reference + candidate > 0 ? 2.0 * matched / (reference + candidate) : 1.0;
+    }
+};
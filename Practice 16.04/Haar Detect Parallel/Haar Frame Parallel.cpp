@@ -0,0 +1,88 @@
+﻿#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "Haar Common.h"
+#include "Frame Parallel.h"
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+// Скорость одного декодирования без обработки - верхняя граница для любого числа потоков
+double measureDecodeFps(const string& path) {
+    VideoCapture cap(path);
+    Mat img;
+    long frames = 0;
+    auto start = steady_clock::now();
+    while (cap.read(img))
+        ++frames;
+    double ms = elapsedMs(start, steady_clock::now());
+    return ms > 0 ? frames * 1000.0 / ms : 0.0;
+}
+
+int main(int argc, char* argv[]) {
+    string path = argc > 1 ? argv[1] : "vid.mp4";
+    int max_workers = argc > 2 ? atoi(argv[2]) : (int)thread::hardware_concurrency();
+    if (max_workers < 1)
+        max_workers = 1;
+
+    // Потоки распределяются по кадрам, внутренний пул OpenCV только мешал бы им
+    setNumThreads(1);
+
+    VideoCapture probe(path);
+    if (!probe.isOpened()) {
+        cerr << "Error: Failed to open video file!" << endl;
+        return -1;
+    }
+    Size frameSize(static_cast<int>(probe.get(CAP_PROP_FRAME_WIDTH)), static_cast<int>(probe.get(CAP_PROP_FRAME_HEIGHT)));
+    probe.release();
+
+    // Клонированные наборы каскадов: отдельная загрузка для каждого рабочего потока
+    vector<CascadeSet> all_sets;
+    string error;
+    if (!loadCascadeSets(all_sets, max_workers, error)) {
+        cerr << "Error: " << error << endl;
+        return -1;
+    }
+
+    double decode_fps = measureDecodeFps(path);
+    cout << "Decoder limit: " << decode_fps << " FPS" << endl << endl;
+    cout << "Workers   FPS      speedup   of decoder limit   order" << endl;
+
+    vector<int> worker_counts;
+    for (int w = 1; w < max_workers; w *= 2)
+        worker_counts.push_back(w);
+    worker_counts.push_back(max_workers);
+
+    double base_fps = 0;
+    for (int workers : worker_counts) {
+        VideoCapture cap(path);
+        VideoWriter writer("result.mp4", VideoWriter::fourcc('a', 'v', 'c', '1'), 30, frameSize, true);
+
+        bool ordered = true;
+        long expected = 0;
+        auto start = steady_clock::now();
+
+        long frames = processFramesParallel(cap, all_sets.data(), workers, true, [&](FrameJob& job) {
+            if (job.index != expected++)
+                ordered = false;
+            writer.write(job.img);
+        });
+
+        double ms = elapsedMs(start, steady_clock::now());
+        writer.release();
+
+        double fps = ms > 0 ? frames * 1000.0 / ms : 0.0;
+        if (workers == 1)
+            base_fps = fps;
+        printf("%7d %7.1f %8.2fx %15.1f%%   %s\n", workers, fps, base_fps > 0 ? fps / base_fps : 0.0,
+            decode_fps > 0 ? 100.0 * fps / decode_fps : 0.0, ordered ? "ok" : "BROKEN");
+    }
+
+    return 0;
+}
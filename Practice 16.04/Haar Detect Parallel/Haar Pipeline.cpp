@@ -0,0 +1,177 @@
+﻿#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "Haar Common.h"
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+// Конвейер: декодирование -> обнаружение -> рисование -> кодирование, каждая стадия в своём потоке.
+// Кадры берутся из фиксированного пула и возвращаются в него после записи, поэтому буферы Mat
+// переиспользуются, а декодер останавливается, если последующие стадии не успевают.
+
+// Кадр из пула со всеми промежуточными данными
+struct Frame {
+    int index = 0;
+    Mat img, gray;
+    Detections det;
+    steady_clock::time_point started;
+};
+
+// Время работы стадии без учёта ожидания в очередях
+struct StageStats {
+    const char* name;
+    double busy_ms = 0;
+    double max_ms = 0;
+    long frames = 0;
+
+    explicit StageStats(const char* name) : name(name) {}
+
+    void add(double ms) {
+        busy_ms += ms;
+        if (ms > max_ms)
+            max_ms = ms;
+        ++frames;
+    }
+};
+
+const size_t QUEUE_CAPACITY = 4;
+
+int main(int argc, char* argv[]) {
+    // --headless отключает окно: без него вывод кадра на экран входит в стадию кодирования
+    bool headless = argc > 1 && string(argv[1]) == "--headless";
+
+    // Открытие видеофайла
+    VideoCapture cap("vid.mp4");
+    if (!cap.isOpened()) {
+        cerr << "Error: Failed to open video file!" << endl;
+        return -1;
+    }
+
+    // Загрузка каскадов Хаара
+    CascadeSet cascades;
+    string error;
+    if (!cascades.load(error)) {
+        cerr << "Error: " << error << endl;
+        return -1;
+    }
+
+    int frame_width = static_cast<int>(cap.get(CAP_PROP_FRAME_WIDTH));
+    int frame_height = static_cast<int>(cap.get(CAP_PROP_FRAME_HEIGHT));
+    Size frameSize(frame_width, frame_height);
+
+    VideoWriter writer("result.mp4", VideoWriter::fourcc('a', 'v', 'c', '1'), 30, frameSize, true);
+
+    // Пул кадров: по одному на место в каждой очереди и на каждую стадию
+    const size_t pool_size = 3 * QUEUE_CAPACITY + 4;
+    vector<Frame> pool(pool_size);
+    BoundedQueue<Frame*> free_frames(pool_size);
+    for (auto& frame : pool)
+        free_frames.push(&frame);
+
+    BoundedQueue<Frame*> decoded(QUEUE_CAPACITY), detected(QUEUE_CAPACITY), annotated(QUEUE_CAPACITY);
+    StageStats decode_stats("decode"), detect_stats("detect"), annotate_stats("annotate"), encode_stats("encode");
+    atomic<bool> stop(false);
+
+    auto start = steady_clock::now();
+
+    thread decoder([&] {
+        int index = 0;
+        Frame* frame;
+        while (!stop.load() && free_frames.pop(frame)) {
+            auto t0 = steady_clock::now();
+            cap >> frame->img;
+            if (frame->img.empty())
+                break;
+            frame->index = index++;
+            frame->started = t0;
+            decode_stats.add(elapsedMs(t0, steady_clock::now()));
+            decoded.push(frame);
+        }
+        decoded.close();
+    });
+
+    thread detector([&] {
+        Frame* frame;
+        while (decoded.pop(frame)) {
+            auto t0 = steady_clock::now();
+            prepareGray(frame->img, frame->gray);
+            detectFullFrame(cascades, frame->gray, frame->det);
+            filterByFaces(frame->det);
+            detect_stats.add(elapsedMs(t0, steady_clock::now()));
+            detected.push(frame);
+        }
+        detected.close();
+    });
+
+    thread annotator([&] {
+        Frame* frame;
+        while (detected.pop(frame)) {
+            auto t0 = steady_clock::now();
+            drawDetections(frame->img, frame->det);
+            annotate_stats.add(elapsedMs(t0, steady_clock::now()));
+            annotated.push(frame);
+        }
+        annotated.close();
+    });
+
+    // Стадия кодирования работает в главном потоке, потому что окно OpenCV
+    // должно обслуживаться из него
+    double total_latency = 0, max_latency = 0;
+    long frames = 0;
+    Frame* frame;
+    while (annotated.pop(frame)) {
+        auto t0 = steady_clock::now();
+        writer.write(frame->img);
+        if (!headless) {
+            imshow("Detected", frame->img);
+            // Выход при нажатии клавиши ESC
+            if ((waitKey(1) & 0xEFFFFF) == 27)
+                stop = true;
+        }
+        auto t1 = steady_clock::now();
+        encode_stats.add(elapsedMs(t0, t1));
+
+        double latency = elapsedMs(frame->started, t1);
+        total_latency += latency;
+        if (latency > max_latency)
+            max_latency = latency;
+        ++frames;
+
+        free_frames.push(frame);
+    }
+
+    // Декодер может ждать свободный кадр после нажатия ESC
+    free_frames.close();
+    decoder.join();
+    detector.join();
+    annotator.join();
+
+    double wall_ms = elapsedMs(start, steady_clock::now());
+
+    writer.release();
+    cap.release();
+    if (!headless)
+        destroyAllWindows();
+
+    // Вывод статистики
+    cout << "Frames: " << frames << endl;
+    cout << "Total time: " << wall_ms << " ms" << endl;
+    cout << "End-to-end FPS: " << (wall_ms > 0 ? frames * 1000.0 / wall_ms : 0.0) << endl;
+    cout << "Frame latency: avg " << (frames ? total_latency / frames : 0.0) << " ms, max " << max_latency << " ms\n\n";
+
+    cout << "Stage       avg ms    max ms    utilization\n";
+    for (const StageStats* s : { &decode_stats, &detect_stats, &annotate_stats, &encode_stats }) {
+        double avg = s->frames ? s->busy_ms / s->frames : 0.0;
+        double utilization = wall_ms > 0 ? 100.0 * s->busy_ms / wall_ms : 0.0;
+        printf("%-10s %7.2f  %8.2f   %8.1f%%\n", s->name, avg, s->max_ms, utilization);
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+﻿#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <omp.h>
+#include "Haar Common.h"
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+// Сравнение двух режимов на одном видео:
+//  - полный кадр: три каскада по всему кадру, затем фильтр по лицам (как в Haar Detect Parallel.cpp);
+//  - области лиц: глаза и улыбки ищутся только внутри найденных лиц.
+
+int main(int argc, char* argv[]) {
+    string path = argc > 1 ? argv[1] : "vid.mp4";
+
+    VideoCapture cap(path);
+    if (!cap.isOpened()) {
+        cerr << "Error: Failed to open video file!" << endl;
+        return -1;
+    }
+
+    // Отдельный набор каскадов для каждого потока
+    vector<CascadeSet> sets;
+    string error;
+    if (!loadCascadeSets(sets, omp_get_max_threads(), error)) {
+        cerr << "Error: " << error << endl;
+        return -1;
+    }
+
+    Mat img, gray;
+    double time_full = 0, time_roi = 0;
+    long frames = 0;
+    Agreement faces, eyes, smiles;
+
+    while (true) {
+        cap >> img;
+        if (img.empty()) {
+            break;
+        }
+        prepareGray(img, gray);
+
+        // Обнаружение по всему кадру
+        Detections full;
+        auto start_full = steady_clock::now();
+        detectFullFrame(sets[0], gray, full);
+        filterByFaces(full);
+        auto end_full = steady_clock::now();
+
+        // Обнаружение внутри лиц
+        Detections roi;
+        auto start_roi = steady_clock::now();
+        detectInFaceROIs(sets, gray, roi);
+        auto end_roi = steady_clock::now();
+
+        time_full += elapsedMs(start_full, end_full);
+        time_roi += elapsedMs(start_roi, end_roi);
+        ++frames;
+
+        faces.add(full.faces, roi.faces);
+        eyes.add(full.eyes, roi.eyes);
+        smiles.add(full.smiles, roi.smiles);
+    }
+
+    cap.release();
+
+    if (frames == 0) {
+        cerr << "Error: video has no frames!" << endl;
+        return -1;
+    }
+
+    // Вывод результатов
+    cout << "Frames: " << frames << ", threads: " << sets.size() << endl;
+    cout << "Full-frame detection: " << time_full / frames << " ms/frame" << endl;
+    cout << "Face ROI detection:   " << time_roi / frames << " ms/frame" << endl;
+    cout << "Speedup: " << time_full / time_roi << "x" << endl << endl;
+
+    cout << "Agreement (IoU >= 0.5)   full   roi   matched   F1" << endl;
+    const pair<const char*, Agreement*> kinds[] = { { "faces", &faces }, { "eyes", &eyes }, { "smiles", &smiles } };
+    for (const auto& kind : kinds) {
+        const Agreement& a = *kind.second;
+        printf("  %-22s %6ld %5ld %9ld   %.3f\n", kind.first, a.reference, a.candidate, a.matched, a.score());
+    }
+
+    return 0;
+}
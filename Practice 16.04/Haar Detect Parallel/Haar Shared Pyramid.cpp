@@ -0,0 +1,95 @@
+﻿#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <omp.h>
+#include "Haar Common.h"
+#include "Shared Pyramid.h"
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+// Сравнение на одном видео:
+//  - три вызова detectMultiScale, каждый со своей пирамидой (как в Haar Detect Parallel.cpp);
+//  - общая пирамида кадра, на которой проверяются все три каскада.
+
+int main(int argc, char* argv[]) {
+    string path = argc > 1 ? argv[1] : "vid.mp4";
+
+    VideoCapture cap(path);
+    if (!cap.isOpened()) {
+        cerr << "Error: Failed to open video file!" << endl;
+        return -1;
+    }
+
+    // Отдельный набор каскадов для каждого потока
+    vector<CascadeSet> sets;
+    string error;
+    if (!loadCascadeSets(sets, omp_get_max_threads(), error)) {
+        cerr << "Error: " << error << endl;
+        return -1;
+    }
+
+    SharedPyramidDetector shared(sets);
+
+    Mat img, gray;
+    double time_separate = 0, time_shared = 0;
+    long frames = 0;
+    Agreement faces, eyes, smiles;
+
+    while (true) {
+        cap >> img;
+        if (img.empty()) {
+            break;
+        }
+        prepareGray(img, gray);
+
+        // Отдельная пирамида для каждого каскада
+        Detections separate;
+        auto start_separate = steady_clock::now();
+        detectFullFrame(sets[0], gray, separate);
+        filterByFaces(separate);
+        auto end_separate = steady_clock::now();
+
+        // Общая пирамида
+        Detections common;
+        auto start_shared = steady_clock::now();
+        shared.detect(gray, common);
+        filterByFaces(common);
+        auto end_shared = steady_clock::now();
+
+        time_separate += elapsedMs(start_separate, end_separate);
+        time_shared += elapsedMs(start_shared, end_shared);
+        ++frames;
+
+        faces.add(separate.faces, common.faces);
+        eyes.add(separate.eyes, common.eyes);
+        smiles.add(separate.smiles, common.smiles);
+    }
+
+    cap.release();
+
+    if (frames == 0) {
+        cerr << "Error: video has no frames!" << endl;
+        return -1;
+    }
+
+    // Вывод результатов
+    cout << "Frames: " << frames << ", threads: " << sets.size() << ", pyramid levels: " << shared.levelCount() << endl;
+    cout << "Separate pyramids: " << time_separate / frames << " ms/frame" << endl;
+    cout << "Shared pyramid:    " << time_shared / frames << " ms/frame (build "
+         << shared.pyramid_ms / frames << " ms, cascades " << shared.cascade_ms / frames << " ms)" << endl;
+    cout << "Speedup: " << time_separate / time_shared << "x" << endl << endl;
+
+    cout << "Agreement (IoU >= 0.5)   separate shared matched   F1" << endl;
+    const pair<const char*, Agreement*> kinds[] = { { "faces", &faces }, { "eyes", &eyes }, { "smiles", &smiles } };
+    for (const auto& kind : kinds) {
+        const Agreement& a = *kind.second;
+        printf("  %-22s %8ld %6ld %7ld   %.3f\n", kind.first, a.reference, a.candidate, a.matched, a.score());
+    }
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+﻿#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <omp.h>
+#include "Haar Common.h"
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+// Полное обнаружение только на опорных кадрах. Между ними лица переносятся оптическим
+// потоком Лукаса-Канаде по точкам внутри лица, глаза и улыбки сдвигаются вместе со своим лицом.
+// Новое обнаружение запускается по истечении интервала или при падении уверенности трекера,
+// а сам интервал подстраивается под скорость движения лиц.
+
+const int MIN_INTERVAL = 1;
+const int MAX_INTERVAL = 30;
+const double MIN_CONFIDENCE = 0.6;   // доля надёжно прослеженных точек
+const double FAST_MOTION = 0.05;     // сдвиг за кадр в долях ширины лица
+const double SLOW_MOTION = 0.01;
+
+// Лицо между опорными кадрами: положение храним в float, чтобы не копить ошибку округления,
+// глаза и улыбки - смещениями относительно левого верхнего угла лица
+struct TrackedFace {
+    Point2f origin;
+    Size size;
+    vector<Rect> eyes, smiles;
+};
+
+// Сдвиг лица между кадрами как медиана сдвигов точек, прошедших проверку
+// "вперёд-назад". Возвращает долю таких точек (уверенность)
+double trackFace(const Mat& prev, const Mat& next, const Rect& face, Point2f& shift) {
+    Rect roi = face & Rect(0, 0, prev.cols, prev.rows);
+    if (roi.area() < 64)
+        return 0.0;
+
+    vector<Point2f> points;
+    goodFeaturesToTrack(prev(roi), points, 40, 0.01, 3);
+    if (points.size() < 5)
+        return 0.0;
+    for (auto& p : points) {
+        p.x += roi.x;
+        p.y += roi.y;
+    }
+
+    vector<Point2f> forward, backward;
+    vector<uchar> status_fwd, status_bwd;
+    vector<float> err;
+    calcOpticalFlowPyrLK(prev, next, points, forward, status_fwd, err);
+    calcOpticalFlowPyrLK(next, prev, forward, backward, status_bwd, err);
+
+    vector<float> dx, dy;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (!status_fwd[i] || !status_bwd[i])
+            continue;
+        if (hypot(backward[i].x - points[i].x, backward[i].y - points[i].y) > 1.0)
+            continue;
+        dx.push_back(forward[i].x - points[i].x);
+        dy.push_back(forward[i].y - points[i].y);
+    }
+    if (dx.size() < 3)
+        return 0.0;
+
+    nth_element(dx.begin(), dx.begin() + dx.size() / 2, dx.end());
+    nth_element(dy.begin(), dy.begin() + dy.size() / 2, dy.end());
+    shift = Point2f(dx[dx.size() / 2], dy[dy.size() / 2]);
+    return (double)dx.size() / points.size();
+}
+
+Rect faceRect(const TrackedFace& t) {
+    return Rect((int)lround(t.origin.x), (int)lround(t.origin.y), t.size.width, t.size.height);
+}
+
+// Обнаружения на опорном кадре -> набор отслеживаемых лиц
+vector<TrackedFace> startTracks(const Detections& det) {
+    vector<TrackedFace> tracks;
+    for (const auto& face : det.faces) {
+        TrackedFace t;
+        t.origin = Point2f((float)face.x, (float)face.y);
+        t.size = Size(face.width, face.height);
+        for (const auto& r : det.eyes)
+            if (face.contains(Point(r.x, r.y)))
+                t.eyes.push_back(Rect(r.x - face.x, r.y - face.y, r.width, r.height));
+        for (const auto& r : det.smiles)
+            if (face.contains(Point(r.x, r.y)))
+                t.smiles.push_back(Rect(r.x - face.x, r.y - face.y, r.width, r.height));
+        tracks.push_back(t);
+    }
+    return tracks;
+}
+
+Detections tracksToDetections(const vector<TrackedFace>& tracks) {
+    Detections det;
+    for (const auto& t : tracks) {
+        Rect face = faceRect(t);
+        det.faces.push_back(face);
+        for (const auto& r : t.eyes)
+            det.eyes.push_back(Rect(face.x + r.x, face.y + r.y, r.width, r.height));
+        for (const auto& r : t.smiles)
+            det.smiles.push_back(Rect(face.x + r.x, face.y + r.y, r.width, r.height));
+    }
+    return det;
+}
+
+// Результат одного прохода по видео
+struct RunStats {
+    long frames = 0;
+    long keyframes = 0;
+    double processing_ms = 0; // без учёта декодирования
+    Agreement faces, eyes, smiles;
+};
+
+// Эталонный проход: полное обнаружение на каждом кадре
+bool runReference(const string& path, CascadeSet& cascades, vector<Detections>& reference, RunStats& stats) {
+    VideoCapture cap(path);
+    if (!cap.isOpened())
+        return false;
+
+    Mat img, gray;
+    while (true) {
+        cap >> img;
+        if (img.empty())
+            break;
+
+        auto t0 = steady_clock::now();
+        prepareGray(img, gray);
+        Detections det;
+        detectFullFrame(cascades, gray, det);
+        filterByFaces(det);
+        stats.processing_ms += elapsedMs(t0, steady_clock::now());
+
+        reference.push_back(det);
+        ++stats.frames;
+        ++stats.keyframes;
+    }
+    return true;
+}
+
+// Проход с опорными кадрами и отслеживанием; точность считается относительно эталона
+bool runTracking(const string& path, CascadeSet& cascades, const vector<Detections>& reference,
+    int start_interval, RunStats& stats) {
+    VideoCapture cap(path);
+    if (!cap.isOpened())
+        return false;
+
+    Mat img, gray, prev_gray;
+    vector<TrackedFace> tracks;
+    int interval = start_interval;
+    int since_keyframe = 0;
+
+    while (true) {
+        cap >> img;
+        if (img.empty() || stats.frames >= (long)reference.size())
+            break;
+
+        auto t0 = steady_clock::now();
+        prepareGray(img, gray);
+
+        bool keyframe = prev_gray.empty() || since_keyframe >= interval;
+        if (!keyframe && !tracks.empty()) {
+            vector<Point2f> shifts(tracks.size());
+            vector<double> confidence(tracks.size());
+
+#pragma omp parallel for schedule(dynamic, 1)
+            for (int i = 0; i < (int)tracks.size(); ++i)
+                confidence[i] = trackFace(prev_gray, gray, faceRect(tracks[i]), shifts[i]);
+
+            // Потерянное лицо - сразу новое обнаружение; интервал при этом не меняется,
+            // потому что сдвиги потерянных лиц ничего не говорят о скорости движения
+            keyframe = any_of(confidence.begin(), confidence.end(), [](double c) { return c < MIN_CONFIDENCE; });
+            if (!keyframe) {
+                double max_motion = 0;
+                for (size_t i = 0; i < tracks.size(); ++i) {
+                    tracks[i].origin.x += shifts[i].x;
+                    tracks[i].origin.y += shifts[i].y;
+                    max_motion = max(max_motion, hypot((double)shifts[i].x, (double)shifts[i].y) / tracks[i].size.width);
+                }
+
+                // Быстрое движение - чаще опорные кадры, почти неподвижная сцена - реже
+                if (max_motion > FAST_MOTION)
+                    interval = max(MIN_INTERVAL, interval / 2);
+                else if (max_motion < SLOW_MOTION)
+                    interval = min(MAX_INTERVAL, interval + 1);
+            }
+        }
+
+        if (keyframe) {
+            Detections det;
+            detectFullFrame(cascades, gray, det);
+            filterByFaces(det);
+            tracks = startTracks(det);
+            since_keyframe = 0;
+            ++stats.keyframes;
+        }
+        ++since_keyframe;
+
+        Detections current = tracksToDetections(tracks);
+        stats.processing_ms += elapsedMs(t0, steady_clock::now());
+
+        const Detections& ref = reference[stats.frames];
+        stats.faces.add(ref.faces, current.faces);
+        stats.eyes.add(ref.eyes, current.eyes);
+        stats.smiles.add(ref.smiles, current.smiles);
+
+        swap(prev_gray, gray);
+        ++stats.frames;
+    }
+    return true;
+}
+
+void printRow(const char* mode, const RunStats& s) {
+    double fps = s.processing_ms > 0 ? s.frames * 1000.0 / s.processing_ms : 0.0;
+    printf("  %-14s %8.1f %10.1f%%   %.3f   %.3f   %.3f\n", mode, fps,
+        s.frames ? 100.0 * s.keyframes / s.frames : 0.0, s.faces.score(), s.eyes.score(), s.smiles.score());
+}
+
+int main(int argc, char* argv[]) {
+    // Видео для сравнения передаются аргументами, по умолчанию - vid.mp4
+    vector<string> videos;
+    for (int i = 1; i < argc; ++i)
+        videos.push_back(argv[i]);
+    if (videos.empty())
+        videos.push_back("vid.mp4");
+
+    CascadeSet cascades;
+    string error;
+    if (!cascades.load(error)) {
+        cerr << "Error: " << error << endl;
+        return -1;
+    }
+
+    const int start_intervals[] = { 2, 5, 10, 20 };
+
+    for (const auto& path : videos) {
+        vector<Detections> reference;
+        RunStats full;
+        if (!runReference(path, cascades, reference, full)) {
+            cerr << "Error: Failed to open video file " << path << endl;
+            continue;
+        }
+
+        cout << "\n=== " << path << " (" << full.frames << " frames) ===\n";
+        cout << "  mode                FPS   keyframes   faces F1  eyes F1  smiles F1\n";
+        printRow("every frame", full);
+
+        for (int interval : start_intervals) {
+            RunStats tracked;
+            runTracking(path, cascades, reference, interval, tracked);
+            string mode = "track, N=" + to_string(interval);
+            printRow(mode.c_str(), tracked);
+        }
+    }
+
+    cout << "\nFPS excludes video decoding; F1 is measured against full detection on every frame." << endl;
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+﻿#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "Haar Common.h"
+
+// Общая пирамида изображений для всех каскадов. detectMultiScale каждого каскада строит
+// свою пирамиду из одного и того же кадра; здесь уровни с шагом FACE_PARAMS.scale_factor
+// строятся один раз за кадр (параллельно по уровням) и переиспользуются между кадрами,
+// а каждый каскад проверяется на нужных ему уровнях только в масштабе своего окна.
+// Каскады с более крупным шагом (1.2) берут уровни, ближайшие к своим масштабам.
+// Сырые срабатывания переводятся в координаты кадра и группируются так же, как
+// это делает detectMultiScale (groupRectangles с eps = 0.2).
+//
+// Интегральные изображения OpenCV строит внутри CascadeClassifier и принять готовые
+// через открытый интерфейс не может, поэтому общим остаётся только масштабирование кадра.
+
+struct PyramidLevel {
+    double scale;
+    cv::Mat img;
+};
+
+class SharedPyramidDetector {
+public:
+    // sets - набор каскадов на каждый поток
+    explicit SharedPyramidDetector(std::vector<CascadeSet>& sets) : sets(sets) {}
+
+    void detect(const cv::Mat& gray, Detections& det) {
+        auto t0 = std::chrono::steady_clock::now();
+        buildPyramid(gray);
+        auto t1 = std::chrono::steady_clock::now();
+        evaluate(det);
+        auto t2 = std::chrono::steady_clock::now();
+
+        pyramid_ms += elapsedMs(t0, t1);
+        cascade_ms += elapsedMs(t1, t2);
+    }
+
+    size_t levelCount() const { return levels.size(); }
+
+    // Суммарное время построения пирамиды и проверки каскадов
+    double pyramid_ms = 0;
+    double cascade_ms = 0;
+
+private:
+    // Каскад и уровень пирамиды, на котором его надо проверить
+    struct Job {
+        int kind;
+        int level;
+    };
+
+    cv::CascadeClassifier& cascadeOf(CascadeSet& set, int kind) {
+        return kind == 0 ? set.face : kind == 1 ? set.eye : set.smile;
+    }
+
+    static const CascadeParams& paramsOf(int kind) {
+        return kind == 0 ? FACE_PARAMS : kind == 1 ? EYE_PARAMS : SMILE_PARAMS;
+    }
+
+    // Уровни с шагом FACE_PARAMS.scale_factor, пока в уровень помещается наименьшее окно.
+    // Mat уровней сохраняются между кадрами, поэтому память выделяется только при смене размера
+    void buildPyramid(const cv::Mat& gray) {
+        cv::Size min_window = sets[0].face.getOriginalWindowSize();
+        for (int kind = 1; kind < 3; ++kind) {
+            cv::Size w = cascadeOf(sets[0], kind).getOriginalWindowSize();
+            min_window = cv::Size(std::min(min_window.width, w.width), std::min(min_window.height, w.height));
+        }
+
+        const double step = FACE_PARAMS.scale_factor;
+        size_t count = 0;
+        for (double scale = 1;; scale *= step, ++count) {
+            cv::Size size(cvRound(gray.cols / scale), cvRound(gray.rows / scale));
+            if (size.width < min_window.width || size.height < min_window.height)
+                break;
+            if (count == levels.size())
+                levels.push_back(PyramidLevel());
+            levels[count].scale = scale;
+        }
+        levels.resize(count);
+
+        if (count == 0)
+            return;
+        levels[0].img = gray;
+
+        // Каждый уровень строится из исходного кадра, как и в detectMultiScale, поэтому уровни независимы
+#pragma omp parallel for schedule(dynamic, 1) num_threads((int)sets.size())
+        for (int k = 1; k < (int)count; ++k)
+            cv::resize(gray, levels[k].img,
+                cv::Size(cvRound(gray.cols / levels[k].scale), cvRound(gray.rows / levels[k].scale)), 0, 0,
+                cv::INTER_LINEAR);
+    }
+
+    // Уровни для каскада: масштабы step^k, ближайшие к scale_factor^j, начиная с минимального размера объекта
+    void planLevels(int kind, std::vector<Job>& jobs) {
+        const CascadeParams& params = paramsOf(kind);
+        cv::Size window = cascadeOf(sets[0], kind).getOriginalWindowSize();
+        const double ratio = std::log(params.scale_factor) / std::log(FACE_PARAMS.scale_factor);
+
+        int last = -1;
+        for (int j = 0;; ++j) {
+            int k = (int)std::lround(j * ratio);
+            if (k >= (int)levels.size())
+                break;
+            const PyramidLevel& level = levels[k];
+            if (k == last || level.img.cols < window.width || level.img.rows < window.height)
+                continue;
+            if (cvRound(window.width * level.scale) < params.min_size.width ||
+                cvRound(window.height * level.scale) < params.min_size.height)
+                continue;
+            jobs.push_back({ kind, k });
+            last = k;
+        }
+    }
+
+    void evaluate(Detections& det) {
+        std::vector<Job> jobs;
+        for (int kind = 0; kind < 3; ++kind)
+            planLevels(kind, jobs);
+
+        // Крупные уровни первыми, чтобы мелкие задачи выравнивали нагрузку в конце
+        std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.level < b.level; });
+
+        std::vector<std::vector<cv::Rect>> found(jobs.size());
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads((int)sets.size())
+        for (int j = 0; j < (int)jobs.size(); ++j) {
+            cv::CascadeClassifier& cascade = cascadeOf(sets[omp_get_thread_num()], jobs[j].kind);
+            const PyramidLevel& level = levels[jobs[j].level];
+            cv::Size window = cascade.getOriginalWindowSize();
+
+            // minSize = maxSize = окно каскада: один масштаб, без группировки (minNeighbors = 0)
+            cascade.detectMultiScale(level.img, found[j], 1.1, 0, 0, window, window);
+
+            cv::Size scaled(cvRound(window.width * level.scale), cvRound(window.height * level.scale));
+            for (auto& r : found[j])
+                r = cv::Rect(cvRound(r.x * level.scale), cvRound(r.y * level.scale), scaled.width, scaled.height);
+        }
+
+        std::vector<cv::Rect>* targets[] = { &det.faces, &det.eyes, &det.smiles };
+        for (auto* target : targets)
+            target->clear();
+        for (size_t j = 0; j < jobs.size(); ++j) {
+            auto& target = *targets[jobs[j].kind];
+            target.insert(target.end(), found[j].begin(), found[j].end());
+        }
+        for (int kind = 0; kind < 3; ++kind)
+            cv::groupRectangles(*targets[kind], paramsOf(kind).min_neighbors, 0.2);
+    }
+
+    std::vector<CascadeSet>& sets;
+    std::vector<PyramidLevel> levels;
+};
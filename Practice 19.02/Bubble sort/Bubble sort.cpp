@@ -1,9 +1,13 @@
 ﻿#include <iostream>
 #include <vector>
 #include <cstdlib>
+#include <cstdio>
 #include <ctime>
 #include <chrono>
 #include <omp.h>
+#include <algorithm>
+#include <random>
+#include "Sorting Networks.h"
 
 using namespace std;
 
@@ -36,27 +40,121 @@ void bubbleSortParallel(vector<int>& arr) {
         sorted = true;
 
         // Четная итерация
-        #pragma omp parallel for reduction(|| : sorted)
-            for (int j = 0; j < n - 1; j += 2) {
+        #pragma omp parallel for reduction(&& : sorted)
+            for (int j = 0; j < (int)n - 1; j += 2) {
                 if (arr[j] > arr[j + 1]) {
                     swap(arr[j], arr[j + 1]);
                     sorted = false;
                 }
             }
-            #pragma omp barrier
 
         // Нечетная итерация
-        #pragma omp parallel for reduction(|| : sorted)
-            for (int j = 1; j < n - 1; j += 2) {
+        #pragma omp parallel for reduction(&& : sorted)
+            for (int j = 1; j < (int)n - 1; j += 2) {
                 if (arr[j] > arr[j + 1]) {
                     swap(arr[j], arr[j + 1]);
                     sorted = false;
                 }
             }
-            #pragma omp barrier
     }
 }
 
+// Блочная сортировка чет-нечет: каждый поток сортирует свой блок, затем соседние блоки
+// выполняют слияние-разделение. p фаз хватает только при блоках равного размера, поэтому
+// раунды (чётная и нечётная фаза) повторяются, пока раунд не пройдёт без обменов. Всё
+// происходит в одной параллельной области, фазы разделяются барьерами. num_threads задаёт
+// только верхнюю границу (OMP_THREAD_LIMIT, вложенность, omp_set_dynamic), поэтому число
+// блоков - фактический размер команды
+void blockOddEvenSort(vector<int>& arr, int threads) {
+    const size_t n = arr.size();
+    const int requested = (int)min<size_t>(max(threads, 1), max<size_t>(n, 1));
+
+    // Границы блоков: блок i - [bounds[i], bounds[i + 1])
+    int p = 0;
+    vector<size_t> bounds;
+    // Были ли обмены у потока в раунде; два набора по чётности раунда, чтобы запись в
+    // следующем раунде не пересекалась с чтением итогов предыдущего
+    vector<char> exchanged[2];
+
+    #pragma omp parallel num_threads(requested)
+    {
+        // Неявный барьер после single: дальше все потоки видят готовые границы
+        #pragma omp single
+        {
+            p = omp_get_num_threads();
+            bounds.resize(p + 1);
+            for (int i = 0; i <= p; ++i)
+                bounds[i] = n * i / p;
+            exchanged[0].assign(p, 0);
+            exchanged[1].assign(p, 0);
+        }
+
+        const int id = omp_get_thread_num();
+        int* block = arr.data() + bounds[id];
+        const size_t size = bounds[id + 1] - bounds[id];
+        vector<int> merged(size);
+
+        networkSort(block, size);
+        #pragma omp barrier
+
+        for (int round = 0;; ++round) {
+            exchanged[round % 2][id] = 0;
+            for (int phase = 0; phase < 2; ++phase) {
+                // В чётной фазе пары (0,1), (2,3)..., в нечётной - (1,2), (3,4)...
+                const int partner = (id % 2 == phase % 2) ? id + 1 : id - 1;
+                const bool active = partner >= 0 && partner < p;
+                const int lo = min(id, partner), hi = max(id, partner);
+
+                // Пара уже упорядочена, если максимум нижнего блока не больше минимума верхнего
+                bool exchange = false;
+                if (active && size > 0) {
+                    const int* low = arr.data() + bounds[lo];
+                    const int* high = arr.data() + bounds[hi];
+                    exchange = bounds[hi + 1] > bounds[hi] && low[bounds[hi] - bounds[lo] - 1] > high[0];
+                }
+
+                if (exchange) {
+                    const int* low = arr.data() + bounds[lo];
+                    const int* high = arr.data() + bounds[hi];
+                    const size_t low_size = bounds[lo + 1] - bounds[lo];
+                    const size_t high_size = bounds[hi + 1] - bounds[hi];
+
+                    if (id == lo) {
+                        // Нижний блок забирает size наименьших элементов пары
+                        size_t a = 0, b = 0;
+                        for (size_t k = 0; k < size; ++k)
+                            merged[k] = (b >= high_size || (a < low_size && low[a] <= high[b])) ? low[a++] : high[b++];
+                    } else {
+                        // Верхний блок забирает size наибольших, слияние с конца
+                        size_t a = low_size, b = high_size;
+                        for (size_t k = size; k-- > 0;)
+                            merged[k] = (a == 0 || (b > 0 && high[b - 1] >= low[a - 1])) ? high[--b] : low[--a];
+                    }
+                }
+
+                // Партнёр должен дочитать наш блок до того, как мы его перезапишем
+                #pragma omp barrier
+                if (exchange) {
+                    copy(merged.begin(), merged.end(), block);
+                    exchanged[round % 2][id] = 1;
+                }
+                #pragma omp barrier
+            }
+
+            // Все потоки видят одни и те же флаги после барьера и выходят вместе
+            if (count(exchanged[round % 2].begin(), exchanged[round % 2].end(), 1) == 0)
+                break;
+        }
+    }
+}
+
+// Заполнение массива случайными числами
+void fillRandom(vector<int>& arr, unsigned seed) {
+    mt19937 gen(seed);
+    for (auto& x : arr)
+        x = (int)(gen() & 0x7FFFFFFF);
+}
+
 int main() {
     const int N = 10000;
     vector<int> arr1(N), arr2(N);
@@ -97,5 +195,68 @@ int main() {
     // Вывод количества доступных потоков OpenMP
     cout << "Threads used: " << omp_get_max_threads() << endl;
 
+    // Блочная сортировка чет-нечет на больших массивах в сравнении с последовательной std::sort
+    const int threads = omp_get_max_threads();
+    cout << "\nBlock odd-even sort, threads: " << threads << ", leaf kernel: " << simdLevelName(simdLevel()) << endl;
+    cout << "        N    std::sort ms   block ms   speedup   correct" << endl;
+
+    // Неудобные входы: обратный порядок и "органные трубы" (возрастание, затем убывание);
+    // размеры не делятся на число потоков, так что блоки разной длины
+    bool adversarial_ok = true;
+    int adversarial_cases = 0;
+    for (int t = 1; t <= max(8, threads); ++t)
+        for (size_t size : { (size_t)12, (size_t)1001, (size_t)99991 })
+            for (int pattern = 0; pattern < 2; ++pattern) {
+                vector<int> a(size);
+                for (size_t i = 0; i < size; ++i)
+                    a[i] = pattern == 0 ? (int)(size - i) : (int)min(i, size - i);
+                vector<int> b = a;
+                sort(a.begin(), a.end());
+                blockOddEvenSort(b, t);
+                adversarial_ok = adversarial_ok && a == b;
+                ++adversarial_cases;
+            }
+
+    // Команда меньше запрошенной: вложенная область при max_active_levels = 1 получает
+    // один поток, хотя просят 4
+    const int saved_levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(1);
+    #pragma omp parallel num_threads(2)
+    #pragma omp single
+    for (size_t size : { (size_t)12, (size_t)1001, (size_t)99991 }) {
+        vector<int> a(size);
+        for (size_t i = 0; i < size; ++i)
+            a[i] = (int)(size - i);
+        vector<int> b = a;
+        sort(a.begin(), a.end());
+        blockOddEvenSort(b, 4);
+        adversarial_ok = adversarial_ok && a == b;
+        ++adversarial_cases;
+    }
+    omp_set_max_active_levels(saved_levels);
+
+    cout << "Reversed and organ-pipe inputs, 1.." << max(8, threads) << " threads and a reduced team ("
+         << adversarial_cases << " cases): " << (adversarial_ok ? "correct" : "incorrect") << endl;
+
+    for (size_t size = 10000; size <= 100000000; size *= 10) {
+        vector<int> a(size);
+        fillRandom(a, (unsigned)size);
+        vector<int> b = a;
+
+        auto start_seq = chrono::high_resolution_clock::now();
+        sort(a.begin(), a.end());
+        auto end_seq = chrono::high_resolution_clock::now();
+
+        auto start_block = chrono::high_resolution_clock::now();
+        blockOddEvenSort(b, threads);
+        auto end_block = chrono::high_resolution_clock::now();
+
+        double time_seq = chrono::duration<double, milli>(end_seq - start_seq).count();
+        double time_block = chrono::duration<double, milli>(end_block - start_block).count();
+
+        printf("%9zu %14.2f %10.2f %8.2fx   %s\n", size, time_seq, time_block, time_seq / time_block,
+            (isSorted(b) && a == b) ? "yes" : "no");
+    }
+
     return 0;
 }
@@ -0,0 +1,302 @@
+﻿#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "Sorting Networks.h"
+
+// Параллельные сортировки массивов 32-битных ключей для больших n (10^8 и больше):
+// выборочная, поразрядная LSD, подсчётом и слиянием. Все функции принимают число
+// потоков явно, чтобы бенчмарк мог перебирать его без omp_set_num_threads.
+
+// Проверка массива на отсортированность
+inline bool isSorted(const std::vector<int>& arr) {
+    for (size_t i = 1; i < arr.size(); ++i) {
+        if (arr[i - 1] > arr[i])
+            return false;
+    }
+    return true;
+}
+
+// Наименьший и наибольший ключ
+inline void keyRange(const std::vector<int>& arr, int threads, int& lo, int& hi) {
+    int mn = INT_MAX, mx = INT_MIN;
+    const long long n = (long long)arr.size();
+
+#pragma omp parallel for num_threads(threads) reduction(min : mn) reduction(max : mx)
+    for (long long i = 0; i < n; ++i) {
+        mn = std::min(mn, arr[i]);
+        mx = std::max(mx, arr[i]);
+    }
+
+    lo = mn;
+    hi = mx;
+}
+
+// Сортировка подсчётом применяется, если диапазон ключей не больше этого значения и не больше n
+const size_t COUNTING_MAX_RANGE = 1 << 16;
+
+// Сортировка подсчётом для ключей из [lo, hi]: гистограммы по потокам, затем каждый поток
+// заполняет свою часть результата, начиная с ключа, которому принадлежит её первая позиция
+inline void countingSortParallel(std::vector<int>& arr, int lo, int hi, int threads) {
+    const size_t n = arr.size();
+    const size_t range = (size_t)((long long)hi - lo + 1);
+    std::vector<std::vector<size_t>> hist(threads);
+    std::vector<size_t> start(range + 1, 0);
+
+#pragma omp parallel num_threads(threads)
+    {
+        const int p = omp_get_num_threads(), t = omp_get_thread_num();
+        const size_t begin = n * t / p, end = n * (t + 1) / p;
+
+        auto& h = hist[t];
+        h.assign(range, 0);
+        for (size_t i = begin; i < end; ++i)
+            ++h[arr[i] - lo];
+#pragma omp barrier
+
+#pragma omp for
+        for (long long v = 0; v < (long long)range; ++v) {
+            size_t count = 0;
+            for (int u = 0; u < p; ++u)
+                count += hist[u][v];
+            start[v + 1] = count;
+        }
+
+#pragma omp single
+        for (size_t v = 0; v < range; ++v)
+            start[v + 1] += start[v];
+
+        size_t v = std::upper_bound(start.begin(), start.end(), begin) - start.begin() - 1;
+        for (size_t i = begin; i < end; ++i) {
+            while (start[v + 1] <= i)
+                ++v;
+            arr[i] = (int)(lo + (long long)v);
+        }
+    }
+}
+
+// Разряд ключа для поразрядной сортировки; старший бит инвертируется, чтобы
+// отрицательные числа шли раньше положительных
+inline unsigned radixDigit(int key, int shift) {
+    return (((uint32_t)key ^ 0x80000000u) >> shift) & 0xFF;
+}
+
+// Поразрядная сортировка LSD по 8 бит за проход в одной параллельной области.
+// Каждый поток строит гистограмму своей части, смещения считаются по разрядам, а внутри
+// разряда - по потокам, поэтому распределение устойчиво. Проход пропускается,
+// если все ключи имеют одинаковый разряд
+inline void radixSortParallel(std::vector<int>& arr, int threads) {
+    const size_t n = arr.size();
+    if (n < 2)
+        return;
+
+    std::vector<int> buffer(n);
+    std::vector<std::array<size_t, 256>> hist(threads);
+    int* src = arr.data();
+    int* dst = buffer.data();
+    bool skip = false;
+
+#pragma omp parallel num_threads(threads)
+    {
+        const int p = omp_get_num_threads(), t = omp_get_thread_num();
+        const size_t begin = n * t / p, end = n * (t + 1) / p;
+
+        for (int shift = 0; shift < 32; shift += 8) {
+            auto& h = hist[t];
+            h.fill(0);
+            for (size_t i = begin; i < end; ++i)
+                ++h[radixDigit(src[i], shift)];
+#pragma omp barrier
+
+#pragma omp single
+            {
+                skip = false;
+                size_t offset = 0;
+                for (int d = 0; d < 256; ++d) {
+                    size_t total = 0;
+                    for (int u = 0; u < p; ++u) {
+                        size_t count = hist[u][d];
+                        hist[u][d] = offset;
+                        offset += count;
+                        total += count;
+                    }
+                    if (total == n)
+                        skip = true;
+                }
+            }
+
+            if (!skip) {
+                for (size_t i = begin; i < end; ++i)
+                    dst[h[radixDigit(src[i], shift)]++] = src[i];
+#pragma omp barrier
+#pragma omp single
+                std::swap(src, dst);
+            }
+        }
+
+        if (src != arr.data())
+            std::copy(src + begin, src + end, arr.data() + begin);
+    }
+}
+
+// Корзин в выборочной сортировке на поток: с запасом, чтобы динамическое
+// распределение сглаживало неравные корзины
+const int SAMPLE_SORT_BUCKETS_PER_THREAD = 4;
+// Элементов выборки на корзину
+const int SAMPLE_SORT_OVERSAMPLE = 64;
+
+// Выборочная сортировка: разделители по случайной выборке, распределение по корзинам
+// с гистограммами по потокам, затем каждая корзина сортируется отдельно. Частый ключ
+// занимает в выборке несколько разделителей подряд; корзины между ними не получили бы
+// ничего, поэтому копии такого ключа раскладываются по ним по кругу (по индексу элемента)
+inline void sampleSortParallel(std::vector<int>& arr, int threads) {
+    const size_t n = arr.size();
+    const int buckets = threads * SAMPLE_SORT_BUCKETS_PER_THREAD;
+    if (threads < 2 || n < (size_t)buckets * SAMPLE_SORT_OVERSAMPLE) {
+        std::sort(arr.begin(), arr.end());
+        return;
+    }
+
+    std::mt19937_64 gen(n);
+    std::vector<int> samples(buckets * SAMPLE_SORT_OVERSAMPLE);
+    for (auto& s : samples)
+        s = arr[gen() % n];
+    std::sort(samples.begin(), samples.end());
+
+    std::vector<int> splitters(buckets - 1);
+    for (int b = 1; b < buckets; ++b)
+        splitters[b - 1] = samples[b * SAMPLE_SORT_OVERSAMPLE];
+
+    // run_start[s] - первый разделитель серии равных, в которую входит s
+    std::vector<int> run_start(buckets - 1);
+    for (int s = 0; s < buckets - 1; ++s)
+        run_start[s] = s > 0 && splitters[s] == splitters[s - 1] ? run_start[s - 1] : s;
+
+    std::vector<int> buffer(n);
+    std::vector<std::vector<size_t>> counts(threads, std::vector<size_t>(buckets));
+    std::vector<size_t> bucket_start(buckets + 1);
+
+    // Корзина b - ключи из [splitters[b - 1], splitters[b]). Ключ, равный разделителям
+    // серии run_start..b-1, может лежать в любой из корзин run_start + 1..b: порядок не нарушится
+    auto bucketOf = [&](int key, size_t index) {
+        const int b = (int)(std::upper_bound(splitters.begin(), splitters.end(), key) - splitters.begin());
+        if (b == 0 || splitters[b - 1] != key || run_start[b - 1] == b - 1)
+            return b;
+        const int first = run_start[b - 1] + 1;
+        return first + (int)(index % (size_t)(b - first + 1));
+    };
+
+#pragma omp parallel num_threads(threads)
+    {
+        const int p = omp_get_num_threads(), t = omp_get_thread_num();
+        const size_t begin = n * t / p, end = n * (t + 1) / p;
+
+        auto& c = counts[t];
+        for (size_t i = begin; i < end; ++i)
+            ++c[bucketOf(arr[i], i)];
+#pragma omp barrier
+
+#pragma omp single
+        {
+            size_t offset = 0;
+            for (int b = 0; b < buckets; ++b) {
+                bucket_start[b] = offset;
+                for (int u = 0; u < p; ++u) {
+                    size_t count = counts[u][b];
+                    counts[u][b] = offset;
+                    offset += count;
+                }
+            }
+            bucket_start[buckets] = offset;
+        }
+
+        for (size_t i = begin; i < end; ++i)
+            buffer[c[bucketOf(arr[i], i)]++] = arr[i];
+#pragma omp barrier
+
+#pragma omp for schedule(dynamic, 1)
+        for (int b = 0; b < buckets; ++b) {
+            // Корзина между двумя равными разделителями содержит только копии этого ключа
+            const bool single_key = b > 0 && b < buckets - 1 && splitters[b - 1] == splitters[b];
+            if (!single_key)
+                std::sort(buffer.begin() + bucket_start[b], buffer.begin() + bucket_start[b + 1]);
+            std::copy(buffer.begin() + bucket_start[b], buffer.begin() + bucket_start[b + 1],
+                arr.begin() + bucket_start[b]);
+        }
+    }
+}
+
+// Ниже этих размеров сортировка и слияние выполняются последовательно
+const size_t MERGE_SORT_CUTOFF = 1 << 14;
+const size_t MERGE_CUTOFF = 1 << 15;
+
+// Параллельное слияние: середина большего отрезка делит меньший двоичным поиском,
+// половины сливаются в отдельных задачах
+inline void parallelMerge(const int* a, size_t na, const int* b, size_t nb, int* out) {
+    if (na + nb < MERGE_CUTOFF) {
+        mergeRuns(a, na, b, nb, out);
+        return;
+    }
+    if (na < nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+
+    const size_t ma = na / 2;
+    const size_t mb = std::lower_bound(b, b + nb, a[ma]) - b;
+    out[ma + mb] = a[ma];
+
+#pragma omp task
+    parallelMerge(a, ma, b, mb, out);
+    parallelMerge(a + ma + 1, na - ma - 1, b + mb, nb - mb, out + ma + mb + 1);
+#pragma omp taskwait
+}
+
+// Сортирует data[0, n); результат оказывается в tmp, если into_tmp, иначе в data.
+// Буферы чередуются по уровням рекурсии, поэтому копирования назад нет
+inline void mergeSortTask(int* data, int* tmp, size_t n, bool into_tmp) {
+    if (n <= MERGE_SORT_CUTOFF) {
+        networkSort(data, n);
+        if (into_tmp)
+            std::copy(data, data + n, tmp);
+        return;
+    }
+
+    const size_t half = n / 2;
+#pragma omp task
+    mergeSortTask(data, tmp, half, !into_tmp);
+    mergeSortTask(data + half, tmp + half, n - half, !into_tmp);
+#pragma omp taskwait
+
+    const int* from = into_tmp ? data : tmp;
+    int* to = into_tmp ? tmp : data;
+    parallelMerge(from, half, from + half, n - half, to);
+}
+
+// Параллельная сортировка слиянием на задачах OpenMP
+inline void mergeSortParallel(std::vector<int>& arr, int threads) {
+    std::vector<int> buffer(arr.size());
+
+#pragma omp parallel num_threads(threads)
+#pragma omp single
+    mergeSortTask(arr.data(), buffer.data(), arr.size(), false);
+}
+
+// Сортировка по умолчанию: подсчётом при малом диапазоне ключей, иначе поразрядная
+inline void parallelSort(std::vector<int>& arr, int threads) {
+    if (arr.size() < 2)
+        return;
+
+    int lo, hi;
+    keyRange(arr, threads, lo, hi);
+    const size_t range = (size_t)((long long)hi - lo + 1);
+    if (range <= COUNTING_MAX_RANGE && range <= arr.size())
+        countingSortParallel(arr, lo, hi, threads);
+    else
+        radixSortParallel(arr, threads);
+}
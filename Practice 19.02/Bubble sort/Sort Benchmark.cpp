@@ -0,0 +1,153 @@
+﻿#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <omp.h>
+#include "Parallel Sort.h"
+
+using namespace std;
+using namespace chrono;
+
+// Сравнение параллельных сортировок из Parallel Sort.h с последовательной std::sort
+// на разных распределениях ключей, размерах массива и числе потоков.
+//   Sort Benchmark [max_n]   (по умолчанию 10^8)
+
+struct Distribution {
+    const char* name;
+    function<void(vector<int>&, mt19937&)> fill;
+};
+
+const Distribution DISTRIBUTIONS[] = {
+    // Как в Bubble sort.cpp: ключи от 1 до 10000
+    { "small range", [](vector<int>& a, mt19937& gen) { for (auto& x : a) x = (int)(gen() % 10000) + 1; } },
+    { "uniform 32-bit", [](vector<int>& a, mt19937& gen) { for (auto& x : a) x = (int)gen(); } },
+    { "normal", [](vector<int>& a, mt19937& gen) {
+          normal_distribution<double> dist(0.0, 1e6);
+          for (auto& x : a) x = (int)dist(gen);
+      } },
+    { "few unique", [](vector<int>& a, mt19937& gen) { for (auto& x : a) x = (int)(gen() % 16) * 100000007; } },
+    { "sorted", [](vector<int>& a, mt19937&) { for (size_t i = 0; i < a.size(); ++i) a[i] = (int)i; } },
+    { "reversed", [](vector<int>& a, mt19937&) { for (size_t i = 0; i < a.size(); ++i) a[i] = (int)(a.size() - i); } },
+};
+
+struct Algorithm {
+    const char* name;
+    function<void(vector<int>&, int)> sort;
+};
+
+int main(int argc, char* argv[]) {
+    const size_t max_n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000000;
+    const int max_threads = omp_get_max_threads();
+
+    vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    const Algorithm algorithms[] = {
+        { "sample", sampleSortParallel },
+        { "radix", radixSortParallel },
+        { "merge", mergeSortParallel },
+        { "auto", parallelSort },
+    };
+
+    bool all_correct = true;
+
+    // Листовые ядра из Sorting Networks.h на каждом доступном наборе инструкций:
+    // сортировка блоков независимо друг от друга и слияние двух отсортированных половин
+    const SimdLevel best = simdLevel();
+    vector<int> keys(1 << 22);
+    mt19937 key_gen(1);
+    for (auto& x : keys)
+        x = (int)key_gen();
+
+    auto timeMs = [](const function<void()>& fn) {
+        auto t0 = high_resolution_clock::now();
+        fn();
+        return duration<double, milli>(high_resolution_clock::now() - t0).count();
+    };
+
+    printf("Leaf kernels, %zu keys\n", keys.size());
+    printf("  kernel    block      ms   std ms   speedup   correct\n");
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+        if (level > best)
+            break;
+        simdLevel() = level;
+
+        for (size_t block : { (size_t)16, (size_t)64, (size_t)1 << 14 }) {
+            vector<int> a = keys, b = keys;
+            double ms = timeMs([&] {
+                for (size_t i = 0; i < a.size(); i += block)
+                    networkSort(a.data() + i, min(block, a.size() - i));
+            });
+            double ms_std = timeMs([&] {
+                for (size_t i = 0; i < b.size(); i += block)
+                    sort(b.begin() + i, b.begin() + min(i + block, b.size()));
+            });
+            all_correct = all_correct && a == b;
+            printf("  %-9s %6zu %7.1f %8.1f %8.2fx   %s\n", simdLevelName(level), block, ms, ms_std, ms_std / ms,
+                a == b ? "yes" : "no");
+        }
+
+        vector<int> halves = keys, merged(keys.size()), expected(keys.size());
+        const size_t half = halves.size() / 2;
+        sort(halves.begin(), halves.begin() + half);
+        sort(halves.begin() + half, halves.end());
+        double ms = timeMs([&] { mergeRuns(halves.data(), half, halves.data() + half, halves.size() - half, merged.data()); });
+        double ms_std = timeMs([&] { merge(halves.begin(), halves.begin() + half, halves.begin() + half, halves.end(), expected.begin()); });
+        all_correct = all_correct && merged == expected;
+        printf("  %-9s  merge %7.1f %8.1f %8.2fx   %s\n", simdLevelName(level), ms, ms_std, ms_std / ms,
+            merged == expected ? "yes" : "no");
+    }
+    simdLevel() = best;
+
+    for (size_t n = 1000000; n <= max_n; n *= 10) {
+        for (const auto& dist : DISTRIBUTIONS) {
+            vector<int> source(n);
+            mt19937 gen((unsigned)n);
+            dist.fill(source, gen);
+
+            // Эталон - последовательная std::sort
+            vector<int> reference = source;
+            auto start = high_resolution_clock::now();
+            sort(reference.begin(), reference.end());
+            double time_ref = duration<double, milli>(high_resolution_clock::now() - start).count();
+
+            int lo, hi;
+            keyRange(source, max_threads, lo, hi);
+            const size_t range = (size_t)((long long)hi - lo + 1);
+            const bool counting = range <= COUNTING_MAX_RANGE && range <= n;
+
+            printf("\nN = %zu, %s keys, std::sort: %.1f ms\n", n, dist.name, time_ref);
+            printf("  algorithm  threads        ms    Mkeys/s   speedup   correct\n");
+
+            auto run = [&](const char* name, int threads, const function<void(vector<int>&)>& sortFn) {
+                vector<int> arr = source;
+                auto t0 = high_resolution_clock::now();
+                sortFn(arr);
+                double ms = duration<double, milli>(high_resolution_clock::now() - t0).count();
+
+                bool correct = isSorted(arr) && arr == reference;
+                all_correct = all_correct && correct;
+                printf("  %-9s %8d %9.1f %10.1f %8.2fx   %s\n", name, threads, ms, n / ms / 1000.0, time_ref / ms,
+                    correct ? "yes" : "no");
+            };
+
+            for (int threads : thread_counts) {
+                for (const auto& algo : algorithms)
+                    run(algo.name, threads, [&](vector<int>& arr) { algo.sort(arr, threads); });
+                if (counting)
+                    run("counting", threads, [&](vector<int>& arr) { countingSortParallel(arr, lo, hi, threads); });
+            }
+        }
+    }
+
+    cout << "\nResults are " << (all_correct ? "correct" : "incorrect") << endl;
+
+    return all_correct ? 0 : 1;
+}
@@ -0,0 +1,325 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SORTING_NETWORKS_X86 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+// Битонные сортирующие сети в регистрах AVX2 (8 int) и AVX-512 (16 int) и векторное
+// слияние двух отсортированных отрезков. Ядра собираются с атрибутом target, поэтому
+// программу не нужно компилировать с -mavx2/-mavx512f: набор инструкций выбирается
+// при выполнении, на других платформах используются std::sort и std::merge.
+
+enum class SimdLevel { Scalar, AVX2, AVX512 };
+
+inline SimdLevel detectSimdLevel() {
+#ifdef SORTING_NETWORKS_X86
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+// Набор инструкций, которым пользуются ядра; по умолчанию - самый широкий из доступных.
+// Бенчмарк может понизить его, чтобы сравнить варианты
+inline SimdLevel& simdLevel() {
+    static SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
+
+// Число int в регистре
+inline int simdWidth(SimdLevel level) {
+    return level == SimdLevel::AVX512 ? 16 : level == SimdLevel::AVX2 ? 8 : 1;
+}
+
+// Стадии сети сравнения-обмена для регистра из width элементов: на каждой стадии
+// элемент i сравнивается с perm[i] и берёт максимум, если take_max[i] = -1
+struct NetworkStages {
+    int count = 0;
+    alignas(64) int perm[10][16];
+    alignas(64) int take_max[10][16];
+    unsigned max_mask[10];
+
+    // Стадия с расстоянием j внутри битонных блоков размера k (k = 0 - всё по возрастанию)
+    void add(int width, int j, int k) {
+        max_mask[count] = 0;
+        for (int i = 0; i < width; ++i) {
+            int partner = i ^ j;
+            bool ascending = k == 0 || (i & k) == 0;
+            bool keep_min = (i < partner) == ascending;
+            perm[count][i] = partner;
+            take_max[count][i] = keep_min ? 0 : -1;
+            if (!keep_min)
+                max_mask[count] |= 1u << i;
+        }
+        ++count;
+    }
+};
+
+// Полная битонная сортировка регистра
+inline NetworkStages buildSortStages(int width) {
+    NetworkStages stages;
+    for (int k = 2; k <= width; k *= 2)
+        for (int j = k / 2; j > 0; j /= 2)
+            stages.add(width, j, k);
+    return stages;
+}
+
+// Битонное слияние: сортирует регистр, содержащий битонную последовательность
+inline NetworkStages buildMergeStages(int width) {
+    NetworkStages stages;
+    for (int j = width / 2; j > 0; j /= 2)
+        stages.add(width, j, 0);
+    return stages;
+}
+
+template <int Width>
+const NetworkStages& sortStages() {
+    static const NetworkStages stages = buildSortStages(Width);
+    return stages;
+}
+
+template <int Width>
+const NetworkStages& mergeStages() {
+    static const NetworkStages stages = buildMergeStages(Width);
+    return stages;
+}
+
+// Слияние трёх отсортированных отрезков; нужно для хвостов векторного слияния
+inline void mergeThree(const int* a, size_t na, const int* b, size_t nb, const int* c, size_t nc, int* out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na || j < nb || k < nc) {
+        int va = i < na ? a[i] : INT_MAX;
+        int vb = j < nb ? b[j] : INT_MAX;
+        int vc = k < nc ? c[k] : INT_MAX;
+        if (i < na && va <= vb && va <= vc)
+            *out++ = a[i++];
+        else if (j < nb && vb <= vc)
+            *out++ = b[j++];
+        else
+            *out++ = c[k++];
+    }
+}
+
+#ifdef SORTING_NETWORKS_X86
+
+TARGET_AVX2 inline __m256i applyStagesAvx2(__m256i v, const NetworkStages& stages) {
+    for (int s = 0; s < stages.count; ++s) {
+        __m256i p = _mm256_permutevar8x32_epi32(v, _mm256_load_si256((const __m256i*)stages.perm[s]));
+        __m256i mn = _mm256_min_epi32(v, p), mx = _mm256_max_epi32(v, p);
+        v = _mm256_blendv_epi8(mn, mx, _mm256_load_si256((const __m256i*)stages.take_max[s]));
+    }
+    return v;
+}
+
+// Два отсортированных регистра -> 8 наименьших в lo и 8 наибольших в hi, оба отсортированы
+TARGET_AVX2 inline void mergeRegistersAvx2(__m256i a, __m256i b, __m256i& lo, __m256i& hi, const NetworkStages& stages) {
+    b = _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    lo = applyStagesAvx2(_mm256_min_epi32(a, b), stages);
+    hi = applyStagesAvx2(_mm256_max_epi32(a, b), stages);
+}
+
+// Сортирует каждые 8 элементов; неполный последний кусок дополняется INT_MAX
+TARGET_AVX2 inline void sortChunksAvx2(int* data, size_t n) {
+    const NetworkStages& stages = sortStages<8>();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        _mm256_storeu_si256((__m256i*)(data + i), applyStagesAvx2(v, stages));
+    }
+    if (i < n) {
+        alignas(32) int tail[8];
+        std::fill(tail, tail + 8, INT_MAX);
+        std::copy(data + i, data + n, tail);
+        _mm256_store_si256((__m256i*)tail, applyStagesAvx2(_mm256_load_si256((const __m256i*)tail), stages));
+        std::copy(tail, tail + (n - i), data + i);
+    }
+}
+
+// Векторное слияние: к регистру старших элементов подмешивается следующий блок из того
+// отрезка, чей очередной элемент меньше; младшая половина идёт в результат
+TARGET_AVX2 inline void mergeRunsAvx2(const int* a, size_t na, const int* b, size_t nb, int* out) {
+    if (na < 8 || nb < 8) {
+        std::merge(a, a + na, b, b + nb, out);
+        return;
+    }
+
+    const NetworkStages& stages = mergeStages<8>();
+    __m256i lo, hi;
+    mergeRegistersAvx2(_mm256_loadu_si256((const __m256i*)a), _mm256_loadu_si256((const __m256i*)b), lo, hi, stages);
+    _mm256_storeu_si256((__m256i*)out, lo);
+    out += 8;
+
+    size_t ia = 8, ib = 8;
+    while (ia + 8 <= na && ib + 8 <= nb) {
+        __m256i next;
+        if (a[ia] < b[ib]) {
+            next = _mm256_loadu_si256((const __m256i*)(a + ia));
+            ia += 8;
+        } else {
+            next = _mm256_loadu_si256((const __m256i*)(b + ib));
+            ib += 8;
+        }
+        mergeRegistersAvx2(next, hi, lo, hi, stages);
+        _mm256_storeu_si256((__m256i*)out, lo);
+        out += 8;
+    }
+
+    alignas(32) int rest[8];
+    _mm256_store_si256((__m256i*)rest, hi);
+    mergeThree(rest, 8, a + ia, na - ia, b + ib, nb - ib, out);
+}
+
+// GCC 12 ложно предупреждает о неинициализированных значениях внутри интринсиков AVX-512
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+TARGET_AVX512 inline __m512i applyStagesAvx512(__m512i v, const NetworkStages& stages) {
+    for (int s = 0; s < stages.count; ++s) {
+        __m512i p = _mm512_permutexvar_epi32(_mm512_load_si512(stages.perm[s]), v);
+        __m512i mn = _mm512_min_epi32(v, p), mx = _mm512_max_epi32(v, p);
+        v = _mm512_mask_blend_epi32((__mmask16)stages.max_mask[s], mn, mx);
+    }
+    return v;
+}
+
+TARGET_AVX512 inline void mergeRegistersAvx512(__m512i a, __m512i b, __m512i& lo, __m512i& hi,
+    const NetworkStages& stages) {
+    b = _mm512_permutexvar_epi32(_mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), b);
+    lo = applyStagesAvx512(_mm512_min_epi32(a, b), stages);
+    hi = applyStagesAvx512(_mm512_max_epi32(a, b), stages);
+}
+
+TARGET_AVX512 inline void sortChunksAvx512(int* data, size_t n) {
+    const NetworkStages& stages = sortStages<16>();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_si512(data + i, applyStagesAvx512(_mm512_loadu_si512(data + i), stages));
+    if (i < n) {
+        __mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+        __m512i v = _mm512_mask_loadu_epi32(_mm512_set1_epi32(INT_MAX), mask, data + i);
+        _mm512_mask_storeu_epi32(data + i, mask, applyStagesAvx512(v, stages));
+    }
+}
+
+TARGET_AVX512 inline void mergeRunsAvx512(const int* a, size_t na, const int* b, size_t nb, int* out) {
+    if (na < 16 || nb < 16) {
+        std::merge(a, a + na, b, b + nb, out);
+        return;
+    }
+
+    const NetworkStages& stages = mergeStages<16>();
+    __m512i lo, hi;
+    mergeRegistersAvx512(_mm512_loadu_si512(a), _mm512_loadu_si512(b), lo, hi, stages);
+    _mm512_storeu_si512(out, lo);
+    out += 16;
+
+    size_t ia = 16, ib = 16;
+    while (ia + 16 <= na && ib + 16 <= nb) {
+        __m512i next;
+        if (a[ia] < b[ib]) {
+            next = _mm512_loadu_si512(a + ia);
+            ia += 16;
+        } else {
+            next = _mm512_loadu_si512(b + ib);
+            ib += 16;
+        }
+        mergeRegistersAvx512(next, hi, lo, hi, stages);
+        _mm512_storeu_si512(out, lo);
+        out += 16;
+    }
+
+    alignas(64) int rest[16];
+    _mm512_store_si512(rest, hi);
+    mergeThree(rest, 16, a + ia, na - ia, b + ib, nb - ib, out);
+}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+// Слияние двух отсортированных отрезков в out самым широким доступным ядром
+inline void mergeRuns(const int* a, size_t na, const int* b, size_t nb, int* out) {
+#ifdef SORTING_NETWORKS_X86
+    if (simdLevel() == SimdLevel::AVX512) {
+        mergeRunsAvx512(a, na, b, nb, out);
+        return;
+    }
+    if (simdLevel() == SimdLevel::AVX2) {
+        mergeRunsAvx2(a, na, b, nb, out);
+        return;
+    }
+#endif
+    std::merge(a, a + na, b, b + nb, out);
+}
+
+// Сортирует каждый кусок из simdWidth элементов сетью в регистре
+inline void sortChunks(int* data, size_t n) {
+#ifdef SORTING_NETWORKS_X86
+    if (simdLevel() == SimdLevel::AVX512) {
+        sortChunksAvx512(data, n);
+        return;
+    }
+    if (simdLevel() == SimdLevel::AVX2) {
+        sortChunksAvx2(data, n);
+        return;
+    }
+#endif
+}
+
+// Блоки не больше этого размера сортируются во временном буфере на стеке
+const size_t SMALL_SORT_MAX = 64;
+
+// Сортировка сетями: куски по ширине регистра, затем попарные векторные слияния
+// отрезков с удвоением длины. Подходит как листовое ядро блочных сортировок
+inline void networkSort(int* data, size_t n) {
+    if (n < 2)
+        return;
+    if (simdLevel() == SimdLevel::Scalar) {
+        std::sort(data, data + n);
+        return;
+    }
+
+    sortChunks(data, n);
+
+    int small[SMALL_SORT_MAX];
+    std::vector<int> large;
+    int* buffer = small;
+    if (n > SMALL_SORT_MAX) {
+        large.resize(n);
+        buffer = large.data();
+    }
+
+    int* src = data;
+    int* dst = buffer;
+    for (size_t run = simdWidth(simdLevel()); run < n; run *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * run) {
+            size_t mid = std::min(lo + run, n), hi = std::min(lo + 2 * run, n);
+            mergeRuns(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != data)
+        std::copy(src, src + n, data);
+}
@@ -0,0 +1,457 @@
+﻿#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Умножение матриц по схеме BLIS: C = A * B + beta * C для int, float и double.
+// Матрицы хранятся по строкам, lda/ldb/ldc - расстояние между строками в элементах.
+//
+// Пять вложенных циклов: B разбивается на панели KC x NC (живут в L3), A - на блоки
+// MC x KC (в L2), микропанель B шириной NR - в L1, а плитка MR x NR матрицы C - в
+// регистрах. Блоки A и B перед умножением упаковываются в непрерывные микропанели,
+// дополненные нулями до кратности MR и NR, поэтому микроядро читает память подряд и
+// не обрабатывает края. Потоки OpenMP делят между собой блоки MC (и группы микропанелей,
+// когда строк мало). Микроядро написано на векторных расширениях GCC и собирается под
+// AVX2 и AVX-512 через атрибут target; набор инструкций выбирается при выполнении.
+// Необязательный эпилог вызывается для каждой плитки C сразу после последнего блока по k,
+// пока плитка ещё в L1, - так к произведению добавляются поэлементные слагаемые без
+// отдельного прохода по C.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEMM_X86 1
+#endif
+
+#if defined(__GNUC__)
+#define GEMM_INLINE inline __attribute__((always_inline))
+#else
+#define GEMM_INLINE inline
+#endif
+
+enum class GemmIsa { Generic, AVX2, AVX512 };
+
+inline GemmIsa detectGemmIsa() {
+#ifdef GEMM_X86
+    if (__builtin_cpu_supports("avx512f"))
+        return GemmIsa::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return GemmIsa::AVX2;
+#endif
+    return GemmIsa::Generic;
+}
+
+// Используемый набор инструкций; по умолчанию - самый широкий из доступных
+inline GemmIsa& gemmIsa() {
+    static GemmIsa isa = detectGemmIsa();
+    return isa;
+}
+
+inline const char* gemmIsaName(GemmIsa isa) {
+    switch (isa) {
+    case GemmIsa::AVX512:
+        return "AVX-512";
+    case GemmIsa::AVX2:
+        return "AVX2";
+    default:
+        return "generic";
+    }
+}
+
+// Размеры блоков кэша. KC x NR микропанели B помещается в L1, MC x KC - в L2
+template <typename T>
+struct GemmBlocking {
+    static const int KC = 256;
+    static const int MC = 288;
+    static const int NC = 4096;
+};
+
+template <>
+struct GemmBlocking<double> {
+    static const int KC = 256;
+    static const int MC = 144;
+    static const int NC = 2048;
+};
+
+// Массив, выровненный по 64 байтам (строке кэша и регистру AVX-512)
+template <typename T>
+class AlignedArray {
+public:
+    explicit AlignedArray(size_t size = 0) { resize(size); }
+    ~AlignedArray() { release(); }
+    AlignedArray(const AlignedArray&) = delete;
+    AlignedArray& operator=(const AlignedArray&) = delete;
+    AlignedArray(AlignedArray&& other) noexcept { swap(other); }
+    AlignedArray& operator=(AlignedArray&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    void swap(AlignedArray& other) noexcept {
+        std::swap(ptr, other.ptr);
+        std::swap(capacity, other.capacity);
+    }
+
+    void resize(size_t size) {
+        if (size <= capacity)
+            return;
+        release();
+        ptr = static_cast<T*>(::operator new(size * sizeof(T), std::align_val_t(64)));
+        capacity = size;
+    }
+
+    T* data() { return ptr; }
+    const T* data() const { return ptr; }
+
+private:
+    void release() {
+        if (ptr)
+            ::operator delete(ptr, std::align_val_t(64));
+        ptr = nullptr;
+        capacity = 0;
+    }
+
+    T* ptr = nullptr;
+    size_t capacity = 0;
+};
+
+// Упаковка блока A (mc x kc) в микропанели по MR строк: для каждого k подряд идут MR значений
+template <typename T>
+void packA(int mc, int kc, const T* A, int lda, T* packed, int MR) {
+    for (int i0 = 0; i0 < mc; i0 += MR) {
+        const int rows = std::min(MR, mc - i0);
+        for (int p = 0; p < kc; ++p) {
+            for (int r = 0; r < rows; ++r)
+                packed[r] = A[(size_t)(i0 + r) * lda + p];
+            for (int r = rows; r < MR; ++r)
+                packed[r] = T(0);
+            packed += MR;
+        }
+    }
+}
+
+// Упаковка одной микропанели B (kc x NR): для каждого k подряд идут NR значений строки
+template <typename T>
+void packBPanel(int kc, int cols, const T* B, int ldb, T* packed, int NR) {
+    for (int p = 0; p < kc; ++p) {
+        const T* row = B + (size_t)p * ldb;
+        std::copy(row, row + cols, packed);
+        std::fill(packed + cols, packed + NR, T(0));
+        packed += NR;
+    }
+}
+
+// Запись плитки в C: на первом блоке по k - C = acc + beta * C, на следующих - C += acc
+template <typename T>
+GEMM_INLINE void storeTile(const T* acc, int NR, T* C, int ldc, int rows, int cols, T beta, bool first) {
+    for (int r = 0; r < rows; ++r) {
+        T* c = C + (size_t)r * ldc;
+        const T* a = acc + r * NR;
+        if (!first) {
+            for (int j = 0; j < cols; ++j)
+                c[j] += a[j];
+        } else if (beta == T(0)) {
+            for (int j = 0; j < cols; ++j)
+                c[j] = a[j];
+        } else {
+            for (int j = 0; j < cols; ++j)
+                c[j] = a[j] + beta * c[j];
+        }
+    }
+}
+
+#if defined(__GNUC__)
+
+// Микроядро: плитка MR x (NV векторов) в регистрах, на каждом k - NV загрузок B,
+// MR рассылок A и MR * NV умножений-сложений
+template <typename T, int Bytes, int MR, int NV>
+GEMM_INLINE void microKernel(int kc, const T* a, const T* b, T* C, int ldc, int rows, int cols, T beta, bool first) {
+    typedef T V __attribute__((vector_size(Bytes)));
+    // Тот же вектор для обращений к памяти без требований к выравниванию
+    typedef T VU __attribute__((vector_size(Bytes), aligned(sizeof(T)), may_alias));
+    constexpr int L = Bytes / sizeof(T);
+    constexpr int NR = NV * L;
+
+    V acc[MR][NV];
+#pragma GCC unroll 32
+    for (int r = 0; r < MR; ++r)
+#pragma GCC unroll 4
+        for (int v = 0; v < NV; ++v)
+            acc[r][v] = V{};
+
+    for (int p = 0; p < kc; ++p) {
+        V bv[NV];
+#pragma GCC unroll 4
+        for (int v = 0; v < NV; ++v)
+            bv[v] = *(const VU*)(b + v * L);
+#pragma GCC unroll 32
+        for (int r = 0; r < MR; ++r) {
+            const T ar = a[r];
+#pragma GCC unroll 4
+            for (int v = 0; v < NV; ++v)
+                acc[r][v] += ar * bv[v];
+        }
+        a += MR;
+        b += NR;
+    }
+
+    if (rows == MR && cols == NR) {
+#pragma GCC unroll 32
+        for (int r = 0; r < MR; ++r) {
+            VU* c = (VU*)(C + (size_t)r * ldc);
+#pragma GCC unroll 4
+            for (int v = 0; v < NV; ++v) {
+                if (!first)
+                    c[v] += acc[r][v];
+                else if (beta == T(0))
+                    c[v] = acc[r][v];
+                else
+                    c[v] = acc[r][v] + beta * c[v];
+            }
+        }
+        return;
+    }
+
+    // Краевая плитка: полный результат во временный буфер, в C - только её часть
+    alignas(64) T tile[MR * NR];
+#pragma GCC unroll 32
+    for (int r = 0; r < MR; ++r)
+#pragma GCC unroll 4
+        for (int v = 0; v < NV; ++v)
+            *(VU*)(tile + r * NR + v * L) = acc[r][v];
+    storeTile(tile, NR, C, ldc, rows, cols, beta, first);
+}
+
+#else
+
+template <typename T, int Bytes, int MR, int NV>
+GEMM_INLINE void microKernel(int kc, const T* a, const T* b, T* C, int ldc, int rows, int cols, T beta, bool first) {
+    constexpr int NR = NV * (Bytes / sizeof(T));
+    T acc[MR * NR] = {};
+    for (int p = 0; p < kc; ++p) {
+        for (int r = 0; r < MR; ++r)
+            for (int j = 0; j < NR; ++j)
+                acc[r * NR + j] += a[r] * b[j];
+        a += MR;
+        b += NR;
+    }
+    storeTile(acc, NR, C, ldc, rows, cols, beta, first);
+}
+
+#endif
+
+// Эпилог: apply(ctx, row0, col0, C, ldc, rows, cols) получает готовую плитку C размером
+// rows x cols, её левый верхний угол в полной матрице - (row0, col0)
+template <typename T>
+struct GemmEpilogue {
+    void (*apply)(const void* ctx, int row0, int col0, T* C, int ldc, int rows, int cols);
+    const void* ctx;
+};
+
+// Макроядро: упакованный блок A (mc x kc) на упакованную панель B (kc x nc).
+// epilogue передаётся только на последнем блоке по k, (row0, col0) - положение блока в C
+template <typename T, int Bytes, int MR, int NV>
+GEMM_INLINE void macroKernel(int mc, int nc, int kc, const T* a_packed, const T* b_packed, T* C, int ldc, T beta,
+    bool first, const GemmEpilogue<T>* epilogue, int row0, int col0) {
+    constexpr int NR = NV * (Bytes / sizeof(T));
+    for (int jr = 0; jr < nc; jr += NR) {
+        const T* b = b_packed + (size_t)jr * kc;
+        for (int ir = 0; ir < mc; ir += MR) {
+            T* c = C + (size_t)ir * ldc + jr;
+            const int rows = std::min(MR, mc - ir), cols = std::min(NR, nc - jr);
+            microKernel<T, Bytes, MR, NV>(kc, a_packed + (size_t)ir * kc, b, c, ldc, rows, cols, beta, first);
+            if (epilogue)
+                epilogue->apply(epilogue->ctx, row0 + ir, col0 + jr, c, ldc, rows, cols);
+        }
+    }
+}
+
+template <typename T>
+using MacroKernelFn = void (*)(int, int, int, const T*, const T*, T*, int, T, bool, const GemmEpilogue<T>*, int, int);
+
+// Плитки регистров для каждого набора инструкций: AVX-512 - 12 x 2 вектора (24 аккумулятора
+// из 32 регистров), AVX2 - 6 x 2 (12 из 16), без SIMD - 4 x 2 по 16 байт
+template <typename T>
+void macroKernelGeneric(int mc, int nc, int kc, const T* a, const T* b, T* C, int ldc, T beta, bool first,
+    const GemmEpilogue<T>* epilogue, int row0, int col0) {
+    macroKernel<T, 16, 4, 2>(mc, nc, kc, a, b, C, ldc, beta, first, epilogue, row0, col0);
+}
+
+#ifdef GEMM_X86
+template <typename T>
+__attribute__((target("avx2,fma"))) void macroKernelAvx2(int mc, int nc, int kc, const T* a, const T* b, T* C,
+    int ldc, T beta, bool first, const GemmEpilogue<T>* epilogue, int row0, int col0) {
+    macroKernel<T, 32, 6, 2>(mc, nc, kc, a, b, C, ldc, beta, first, epilogue, row0, col0);
+}
+
+template <typename T>
+__attribute__((target("avx512f"))) void macroKernelAvx512(int mc, int nc, int kc, const T* a, const T* b, T* C,
+    int ldc, T beta, bool first, const GemmEpilogue<T>* epilogue, int row0, int col0) {
+    macroKernel<T, 64, 12, 2>(mc, nc, kc, a, b, C, ldc, beta, first, epilogue, row0, col0);
+}
+#endif
+
+// Параметры микроядра для выбранного набора инструкций
+template <typename T>
+struct GemmKernel {
+    int MR, NR;
+    MacroKernelFn<T> macro;
+};
+
+template <typename T>
+GemmKernel<T> selectGemmKernel(GemmIsa isa) {
+#ifdef GEMM_X86
+    if (isa == GemmIsa::AVX512)
+        return { 12, 2 * 64 / (int)sizeof(T), macroKernelAvx512<T> };
+    if (isa == GemmIsa::AVX2)
+        return { 6, 2 * 32 / (int)sizeof(T), macroKernelAvx2<T> };
+#endif
+    (void)isa;
+    return { 4, 2 * 16 / (int)sizeof(T), macroKernelGeneric<T> };
+}
+
+// C (m x n) = A (m x k) * B (k x n) + beta * C. При beta = 0 исходное C не читается.
+// Внутри параллельной области (например, из задач OpenMP) выполняется в вызывающем потоке
+template <typename T>
+void gemm(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C, int ldc, T beta = T(0),
+    const GemmEpilogue<T>* epilogue = nullptr) {
+    if (m <= 0 || n <= 0)
+        return;
+    if (k <= 0) {
+        for (int i = 0; i < m; ++i)
+            for (int j = 0; j < n; ++j)
+                C[(size_t)i * ldc + j] = beta == T(0) ? T(0) : beta * C[(size_t)i * ldc + j];
+        if (epilogue)
+            epilogue->apply(epilogue->ctx, 0, 0, C, ldc, m, n);
+        return;
+    }
+
+    const GemmKernel<T> kernel = selectGemmKernel<T>(gemmIsa());
+    const int MR = kernel.MR, NR = kernel.NR;
+    const int KC = GemmBlocking<T>::KC, NC = GemmBlocking<T>::NC;
+    const bool nested = omp_in_parallel() != 0;
+    const int threads = nested ? 1 : omp_get_max_threads();
+
+    // Высота блока A: не больше MC, но так, чтобы блоков хватило на все потоки
+    int mc = (m + threads - 1) / threads;
+    mc = std::min(GemmBlocking<T>::MC, (mc + MR - 1) / MR * MR);
+    const int ic_blocks = (m + mc - 1) / mc;
+
+    const int kc_max = std::min(KC, k);
+    const int nc_max = std::min(NC, (n + NR - 1) / NR * NR);
+    AlignedArray<T> b_packed((size_t)kc_max * nc_max);
+
+#pragma omp parallel num_threads(threads) if (!nested)
+    {
+        AlignedArray<T> a_packed((size_t)mc * kc_max);
+
+        for (int jc = 0; jc < n; jc += NC) {
+            const int nc = std::min(NC, n - jc);
+            const int panels = (nc + NR - 1) / NR;
+
+            // Если блоков A меньше, чем потоков, микропанели B тоже делятся между потоками
+            const int jr_groups = std::max(1, std::min(panels, threads / ic_blocks));
+
+            for (int pc = 0; pc < k; pc += KC) {
+                const int kc = std::min(KC, k - pc);
+
+#pragma omp for schedule(static)
+                for (int panel = 0; panel < panels; ++panel) {
+                    const int j0 = panel * NR;
+                    packBPanel(kc, std::min(NR, nc - j0), B + (size_t)pc * ldb + jc + j0, ldb,
+                        b_packed.data() + (size_t)j0 * kc, NR);
+                }
+
+#pragma omp for collapse(2) schedule(dynamic, 1)
+                for (int ib = 0; ib < ic_blocks; ++ib) {
+                    for (int g = 0; g < jr_groups; ++g) {
+                        const int ic = ib * mc;
+                        const int rows = std::min(mc, m - ic);
+                        const int p0 = panels * g / jr_groups, p1 = panels * (g + 1) / jr_groups;
+                        const int j0 = p0 * NR, cols = std::min(nc, p1 * NR) - j0;
+
+                        packA(rows, kc, A + (size_t)ic * lda + pc, lda, a_packed.data(), MR);
+                        kernel.macro(rows, cols, kc, a_packed.data(), b_packed.data() + (size_t)j0 * kc,
+                            C + (size_t)ic * ldc + jc + j0, ldc, beta, pc == 0, pc + kc >= k ? epilogue : nullptr,
+                            ic, jc + j0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Пиковая скорость умножения-сложения без обращений к памяти: 12 независимых цепочек
+// в регистрах на каждом потоке. Ориентир для доли пика, которую достигает gemm
+template <typename T, int Bytes>
+GEMM_INLINE T multiplyAddChains(long iterations, T seed) {
+#if defined(__GNUC__)
+    typedef T V __attribute__((vector_size(Bytes)));
+#else
+    typedef T V;
+#endif
+    V acc[12];
+    for (int i = 0; i < 12; ++i)
+        acc[i] = V{} + seed * T(i);
+    const V mul = V{} + seed, add = V{} + seed;
+    for (long t = 0; t < iterations; ++t)
+#pragma GCC unroll 12
+        for (int i = 0; i < 12; ++i)
+            acc[i] = acc[i] * mul + add;
+    V sum = V{};
+    for (int i = 0; i < 12; ++i)
+        sum += acc[i];
+    T result;
+    std::copy((const T*)&sum, (const T*)&sum + 1, &result);
+    return result;
+}
+
+template <typename T>
+T multiplyAddGeneric(long iterations, T seed) {
+    return multiplyAddChains<T, 16>(iterations, seed);
+}
+
+#ifdef GEMM_X86
+template <typename T>
+__attribute__((target("avx2,fma"))) T multiplyAddAvx2(long iterations, T seed) {
+    return multiplyAddChains<T, 32>(iterations, seed);
+}
+
+template <typename T>
+__attribute__((target("avx512f"))) T multiplyAddAvx512(long iterations, T seed) {
+    return multiplyAddChains<T, 64>(iterations, seed);
+}
+#endif
+
+// Гфлоп/с (для int - миллиарды операций в секунду) на всех потоках
+template <typename T>
+double gemmPeakGflops() {
+    const long iterations = 20000000;
+    int bytes = 16;
+    T (*chains)(long, T) = multiplyAddGeneric<T>;
+#ifdef GEMM_X86
+    if (gemmIsa() == GemmIsa::AVX512) {
+        bytes = 64;
+        chains = multiplyAddAvx512<T>;
+    } else if (gemmIsa() == GemmIsa::AVX2) {
+        bytes = 32;
+        chains = multiplyAddAvx2<T>;
+    }
+#endif
+
+    volatile T sink = T(0);
+    int threads = 1;
+    double start = omp_get_wtime();
+#pragma omp parallel
+    {
+#pragma omp single
+        threads = omp_get_num_threads();
+        T result = chains(iterations, T(1));
+#pragma omp critical
+        sink = sink + result;
+    }
+    double seconds = omp_get_wtime() - start;
+
+    return 2.0 * 12 * (bytes / sizeof(T)) * iterations * threads / seconds / 1e9;
+}
@@ -1,59 +1,250 @@
 ﻿#include <iostream>
-#include <vector>
 #include <cstdlib>
 #include <ctime>
 #include <chrono>
 #include <omp.h>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include <string>
+#include "Gemm.h"
+#include "Matrix.h"
+#include "Strassen.h"
 
 using namespace std;
 using namespace chrono;
 
-const int SIZE = 500;
+// Размер матриц по умолчанию для сравнения с простыми циклами
+const int DEFAULT_SIZE = 500;
 
 // Функция для заполнения матрицы случайными числами
-void fill_matrix(vector<vector<int>>& matrix) {
-    for (int i = 0; i < SIZE; ++i)
-        for (int j = 0; j < SIZE; ++j)
+void fill_matrix(Matrix<int>& matrix) {
+    for (int i = 0; i < matrix.rows(); ++i)
+        for (int j = 0; j < matrix.cols(); ++j)
             matrix[i][j] = rand() % 100;
 }
 
 // Последовательное умножение матриц
-void multiply_sequential(const vector<vector<int>>& A, const vector<vector<int>>& B, vector<vector<int>>& C) {
-    for (int i = 0; i < SIZE; ++i)
-        for (int j = 0; j < SIZE; ++j) {
+void multiply_sequential(const Matrix<int>& A, const Matrix<int>& B, Matrix<int>& C) {
+    const int n = A.rows();
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j) {
             C[i][j] = 0;
-            for (int k = 0; k < SIZE; ++k)
+            for (int k = 0; k < n; ++k)
                 C[i][j] += A[i][k] * B[k][j];
         }
 }
 
 // Параллельное умножение матриц
-void multiply_parallel(const vector<vector<int>>& A, const vector<vector<int>>& B, vector<vector<int>>& C) {
+void multiply_parallel(const Matrix<int>& A, const Matrix<int>& B, Matrix<int>& C) {
+    const int n = A.rows();
 #pragma omp parallel for
-    for (int i = 0; i < SIZE; ++i)
-        for (int j = 0; j < SIZE; ++j) {
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j) {
             C[i][j] = 0;
-            for (int k = 0; k < SIZE; ++k)
+            for (int k = 0; k < n; ++k)
                 C[i][j] += A[i][k] * B[k][j];
         }
 }
 
 // Проверка на совпадение двух матриц
-bool compare_matrices(const vector<vector<int>>& M1, const vector<vector<int>>& M2) {
-    for (int i = 0; i < SIZE; ++i)
-        for (int j = 0; j < SIZE; ++j)
+bool compare_matrices(const Matrix<int>& M1, const Matrix<int>& M2) {
+    for (int i = 0; i < M1.rows(); ++i)
+        for (int j = 0; j < M1.cols(); ++j)
             if (M1[i][j] != M2[i][j])
                 return false;
     return true;
 }
 
-int main() {
+// Случайная матрица: целые - как в fill_matrix, вещественные - из [-1, 1]
+template <typename T>
+Matrix<T> random_matrix(int rows, int cols) {
+    Matrix<T> M(rows, cols);
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < cols; ++j)
+            M[i][j] = is_integral<T>::value ? (T)(rand() % 100) : (T)(rand() / (double)RAND_MAX * 2 - 1);
+    return M;
+}
+
+// Проверка результата gemm на выборке строк по прямой сумме в long double.
+// Возвращает наибольшую относительную ошибку (для int - 0, если всё совпало точно)
+template <typename T>
+double gemm_error(const Matrix<T>& A, const Matrix<T>& B, const Matrix<T>& C) {
+    const int m = A.rows(), n = B.cols(), k = A.cols();
+    double max_error = 0;
+    for (int s = 0; s < 16; ++s) {
+        int i = (int)((long long)s * 7919 % m);
+        for (int j = 0; j < n; ++j) {
+            long double exact = 0, magnitude = 0;
+            for (int p = 0; p < k; ++p) {
+                long double term = (long double)A[i][p] * B[p][j];
+                exact += term;
+                magnitude += fabsl(term);
+            }
+            double error = (double)(fabsl(C[i][j] - exact) / max(magnitude, 1.0L));
+            max_error = max(max_error, error);
+        }
+    }
+    return max_error;
+}
+
+// Скорость gemm на матрицах m x k и k x n и доля пиковой скорости умножения-сложения
+template <typename T>
+void benchmark_gemm(const char* type_name, int m, int n, int k, double peak) {
+    Matrix<T> A = random_matrix<T>(m, k), B = random_matrix<T>(k, n), C(m, n);
+
+    // Лучшее из трёх запусков, первый заодно прогревает память
+    double best = 1e30;
+    for (int run = 0; run < 3; ++run) {
+        auto start = high_resolution_clock::now();
+        C = A * B;
+        best = min(best, duration<double>(high_resolution_clock::now() - start).count());
+    }
+
+    double gflops = 2.0 * m * n * k / best / 1e9;
+    printf("%-7s %5d x %5d x %5d %9.1f %9.1f %6.1f%%   %.1e\n", type_name, m, n, k, best * 1000, gflops,
+        100 * gflops / peak, gemm_error(A, B, C));
+}
+
+// Время одного умножения: лучшее из трёх запусков
+template <typename F>
+double best_time(F multiply) {
+    double best = 1e30;
+    for (int run = 0; run < 3; ++run) {
+        auto start = high_resolution_clock::now();
+        multiply();
+        best = min(best, duration<double>(high_resolution_clock::now() - start).count());
+    }
+    return best;
+}
+
+// Штрассен-Виноград против классического gemm на квадратных матрицах n x n:
+// время, ускорение и ошибка обоих результатов относительно суммы в long double
+template <typename T>
+double benchmark_strassen(int n, int cutoff) {
+    Matrix<T> A = random_matrix<T>(n, n), B = random_matrix<T>(n, n), C_gemm(n, n), C_str(n, n);
+
+    double t_gemm = best_time([&] { C_gemm = A * B; });
+    double t_str = best_time([&] { strassen(n, n, n, A.data(), n, B.data(), n, C_str.data(), n, cutoff); });
+
+    double difference = 0, magnitude = 0;
+    for (size_t i = 0; i < C_gemm.size(); ++i) {
+        difference = max(difference, (double)fabs(C_str.data()[i] - C_gemm.data()[i]));
+        magnitude = max(magnitude, (double)fabs(C_gemm.data()[i]));
+    }
+
+    StrassenConfig cfg = { cutoff, 0 };
+    printf("%5d %7d %13.1f %13.1f %8.2fx %11.1e %11.1e %11.1e\n", n, strassenLevels(n, n, n, cfg), t_gemm * 1000,
+        t_str * 1000, t_gemm / t_str, gemm_error(A, B, C_gemm), gemm_error(A, B, C_str),
+        difference / magnitude);
+    return t_gemm / t_str;
+}
+
+// Наибольшее относительное расхождение двух матриц
+template <typename T>
+double max_difference(const Matrix<T>& X, const Matrix<T>& Y) {
+    double difference = 0, magnitude = 0;
+    for (size_t i = 0; i < X.size(); ++i) {
+        difference = max(difference, (double)fabs(X.data()[i] - Y.data()[i]));
+        magnitude = max(magnitude, (double)fabs(Y.data()[i]));
+    }
+    return difference / max(magnitude, 1e-300);
+}
+
+// Слитые выражения против вычисления по шагам с временными матрицами:
+// C = A * B + alpha * D (эпилог gemm) и E = A + alpha * B - D (один проход)
+template <typename T>
+void benchmark_fused(const char* type_name, int n) {
+    Matrix<T> A = random_matrix<T>(n, n), B = random_matrix<T>(n, n), D = random_matrix<T>(n, n);
+    const T alpha = T(3);
+
+    Matrix<T> C_fused, C_steps, scaled, E_fused, E_steps;
+    double t_fused = best_time([&] { C_fused = A * B + alpha * D; });
+    double t_steps = best_time([&] {
+        C_steps = A * B;
+        scaled = alpha * D;
+        C_steps = C_steps + scaled;
+    });
+    printf("%-7s %5d  A*B + alpha*D    %9.2f %9.2f %8.2fx   %.1e\n", type_name, n, t_fused * 1000, t_steps * 1000,
+        t_steps / t_fused, max_difference(C_fused, C_steps));
+
+    t_fused = best_time([&] { E_fused = A + alpha * B - D; });
+    t_steps = best_time([&] {
+        scaled = alpha * B;
+        E_steps = A + scaled;
+        E_steps = E_steps - D;
+    });
+    printf("%-7s %5d  A + alpha*B - D  %9.2f %9.2f %8.2fx   %.1e\n", type_name, n, t_fused * 1000, t_steps * 1000,
+        t_steps / t_fused, max_difference(E_fused, E_steps));
+}
+
+// Режим "strassen [max_n]": подбор порога рекурсии и поиск размера, с которого
+// Штрассен-Виноград обгоняет классическое умножение
+void strassen_report(int max_n) {
+    cout << "Strassen-Winograd (double), GEMM engine: " << gemmIsaName(gemmIsa()) << ", threads: "
+         << omp_get_max_threads() << endl;
+
+    // Порог рекурсии: лучший по времени на n = 2048
+    const int tune_n = min(2048, max_n);
+    Matrix<double> A = random_matrix<double>(tune_n, tune_n), B = random_matrix<double>(tune_n, tune_n);
+    Matrix<double> C(tune_n, tune_n);
+
+    printf("\nCutoff sweep at n = %d:\ncutoff      ms\n", tune_n);
+    int best_cutoff = STRASSEN_CUTOFF;
+    double best = 1e30;
+    for (int cutoff : { 64, 128, 256, 512, 1024 }) {
+        double t = best_time([&] {
+            strassen(tune_n, tune_n, tune_n, A.data(), tune_n, B.data(), tune_n, C.data(), tune_n, cutoff);
+        });
+        printf("%6d %7.1f\n", cutoff, t * 1000);
+        if (t < best) {
+            best = t;
+            best_cutoff = cutoff;
+        }
+    }
+    printf("Best cutoff: %d\n\n", best_cutoff);
+
+    // Ошибки: classical и strassen - относительно суммы |слагаемых|, difference - max |C_s - C_g| / max |C_g|
+    printf("    n  levels  classical ms   strassen ms  speedup   classical    strassen  difference\n");
+    // Размеры без уровней рекурсии совпадают с gemm и в поиске точки перехода не участвуют
+    StrassenConfig cfg = { best_cutoff, 0 };
+    int crossover = 0;
+    for (int n = 512; n <= max_n; n = n % 3 == 0 ? n / 3 * 4 : n / 2 * 3) {
+        double speedup = benchmark_strassen<double>(n, best_cutoff);
+        if (strassenLevels(n, n, n, cfg) == 0)
+            continue;
+        if (speedup > 1 && crossover == 0)
+            crossover = n;
+        else if (speedup <= 1)
+            crossover = 0;
+    }
+    if (crossover)
+        printf("Crossover: Strassen-Winograd is faster from n = %d\n", crossover);
+    else
+        printf("Crossover: Strassen-Winograd is not faster up to n = %d\n", max_n);
+
+    // Нечётные размеры идут через динамическое отсечение
+    printf("\nOdd sizes:\n");
+    for (int n : { 1023, 1025, 2047, 2049 }) {
+        if (n <= max_n)
+            benchmark_strassen<double>(n, best_cutoff);
+    }
+}
+
+int main(int argc, char* argv[]) {
     srand(time(0));
 
-    vector<vector<int>> A(SIZE, vector<int>(SIZE));
-    vector<vector<int>> B(SIZE, vector<int>(SIZE));
-    vector<vector<int>> C_seq(SIZE, vector<int>(SIZE));
-    vector<vector<int>> C_par(SIZE, vector<int>(SIZE));
+    if (argc > 1 && string(argv[1]) == "strassen") {
+        strassen_report(argc > 2 ? atoi(argv[2]) : 4096);
+        return 0;
+    }
+    const int size = argc > 1 ? atoi(argv[1]) : DEFAULT_SIZE;
+
+    Matrix<int> A(size, size);
+    Matrix<int> B(size, size);
+    Matrix<int> C_seq(size, size);
+    Matrix<int> C_par(size, size);
 
     fill_matrix(A);
     fill_matrix(B);
@@ -78,5 +269,35 @@ int main() {
     cout << "Parallel time:   " << duration_par.count() << " ms" << endl;
     cout << "Results are " << (equal ? "correct (equal)" : "different (error)") << endl;
 
+    // Блочное умножение с упаковкой и SIMD-микроядром
+    Matrix<int> C_gemm;
+    auto start_gemm = high_resolution_clock::now();
+    C_gemm = A * B;
+    auto end_gemm = high_resolution_clock::now();
+    auto duration_gemm = duration_cast<microseconds>(end_gemm - start_gemm);
+
+    cout << "GEMM time:       " << duration_gemm.count() / 1000.0 << " ms" << endl;
+    cout << "GEMM results are " << (compare_matrices(C_seq, C_gemm) ? "correct (equal)" : "different (error)") << endl;
+
+    // Квадратные и прямоугольные размеры для int, float и double
+    cout << "\nGEMM engine: " << gemmIsaName(gemmIsa()) << ", threads: " << omp_get_max_threads() << endl;
+    const double peak_int = gemmPeakGflops<int>(), peak_float = gemmPeakGflops<float>(), peak_double = gemmPeakGflops<double>();
+    printf("Multiply-add peak: int %.1f, float %.1f, double %.1f GFLOP/s\n\n", peak_int, peak_float, peak_double);
+    printf("type        m       n       k       ms   GFLOP/s   peak    error\n");
+
+    const int shapes[][3] = { { 1024, 1024, 1024 }, { 2048, 2048, 2048 }, { 4096, 256, 1024 }, { 256, 4096, 2048 }, { 2048, 2048, 128 } };
+    for (const auto& s : shapes) {
+        benchmark_gemm<int>("int", s[0], s[1], s[2], peak_int);
+        benchmark_gemm<float>("float", s[0], s[1], s[2], peak_float);
+        benchmark_gemm<double>("double", s[0], s[1], s[2], peak_double);
+    }
+
+    // Слитые выражения: время одним проходом и по шагам, расхождение результатов
+    printf("\ntype        n  expression        fused ms  steps ms  speedup   difference\n");
+    for (int n : { 1024, 4096 }) {
+        benchmark_fused<float>("float", n);
+        benchmark_fused<double>("double", n);
+    }
+
     return 0;
 }
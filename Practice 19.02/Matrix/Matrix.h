@@ -0,0 +1,421 @@
+﻿#pragma once
+
+#include <omp.h>
+#include <cassert>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include "Gemm.h"
+
+// Плотная матрица с размером, заданным при выполнении: строки лежат подряд в одном блоке,
+// выровненном по 64 байтам. Выражения из +, -, умножения на число и одного произведения
+// матриц строятся шаблонами выражений и вычисляются только при присваивании:
+//   C = A + 2 * B - D;        один параллельный проход без временных матриц
+//   C = A * B + alpha * D;    gemm, слагаемое alpha * D добавляется в его эпилоге
+// Выражение может ссылаться на матрицу, которой присваивается, - тогда произведение
+// считается во временную матрицу.
+
+template <typename E>
+struct MatrixExpr {
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+template <typename T>
+class Matrix;
+
+// Строка матрицы: элементы подряд
+template <typename T>
+class RowView {
+public:
+    RowView(T* data, int size) : ptr(data), n(size) {}
+
+    int size() const { return n; }
+    T& operator[](int j) const { return ptr[j]; }
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + n; }
+
+private:
+    T* ptr;
+    int n;
+};
+
+// Столбец матрицы: элементы с шагом в длину строки
+template <typename T>
+class ColView {
+public:
+    ColView(T* data, int size, int stride) : ptr(data), n(size), step(stride) {}
+
+    int size() const { return n; }
+    T& operator[](int i) const { return ptr[(size_t)i * step]; }
+
+private:
+    T* ptr;
+    int n, step;
+};
+
+// Ссылка на матрицу как лист выражения
+template <typename T>
+class MatrixRef : public MatrixExpr<MatrixRef<T>> {
+public:
+    typedef T value_type;
+
+    MatrixRef(const Matrix<T>& m) : m(m) {}
+
+    int rows() const { return m.rows(); }
+    int cols() const { return m.cols(); }
+    T at(int i, int j) const { return m.at(i, j); }
+    bool refersTo(const void* p) const { return m.refersTo(p); }
+
+private:
+    const Matrix<T>& m;
+};
+
+// Узлы хранят матрицы по ссылке, остальные узлы - по значению
+template <typename E>
+struct ExprStorage {
+    typedef E type;
+};
+
+template <typename T>
+struct ExprStorage<Matrix<T>> {
+    typedef MatrixRef<T> type;
+};
+
+// Нулевое слагаемое: произведение без поэлементной части
+template <typename T>
+class ZeroExpr : public MatrixExpr<ZeroExpr<T>> {
+public:
+    typedef T value_type;
+
+    ZeroExpr(int rows, int cols) : r(rows), c(cols) {}
+
+    int rows() const { return r; }
+    int cols() const { return c; }
+    T at(int, int) const { return T(0); }
+    bool refersTo(const void*) const { return false; }
+
+private:
+    int r, c;
+};
+
+struct PlusOp {
+    template <typename T>
+    static T apply(T a, T b) { return a + b; }
+};
+
+struct MinusOp {
+    template <typename T>
+    static T apply(T a, T b) { return a - b; }
+};
+
+template <typename L, typename R, typename Op>
+class BinaryExpr : public MatrixExpr<BinaryExpr<L, R, Op>> {
+public:
+    typedef typename L::value_type value_type;
+
+    BinaryExpr(const L& left, const R& right) : l(left), r(right) {
+        assert(l.rows() == r.rows() && l.cols() == r.cols());
+    }
+
+    int rows() const { return l.rows(); }
+    int cols() const { return l.cols(); }
+    value_type at(int i, int j) const { return Op::apply(l.at(i, j), r.at(i, j)); }
+    bool refersTo(const void* p) const { return l.refersTo(p) || r.refersTo(p); }
+
+    typename ExprStorage<L>::type l;
+    typename ExprStorage<R>::type r;
+};
+
+template <typename E>
+class ScaleExpr : public MatrixExpr<ScaleExpr<E>> {
+public:
+    typedef typename E::value_type value_type;
+
+    ScaleExpr(value_type alpha, const E& expr) : alpha(alpha), e(expr) {}
+
+    int rows() const { return e.rows(); }
+    int cols() const { return e.cols(); }
+    value_type at(int i, int j) const { return alpha * e.at(i, j); }
+    bool refersTo(const void* p) const { return e.refersTo(p); }
+
+    value_type alpha;
+    typename ExprStorage<E>::type e;
+};
+
+// Произведение матриц; поэлементно не вычисляется, только через gemm при присваивании
+template <typename T>
+class ProductExpr : public MatrixExpr<ProductExpr<T>> {
+public:
+    typedef T value_type;
+
+    ProductExpr(const Matrix<T>& left, const Matrix<T>& right) : a(left), b(right) {
+        assert(a.cols() == b.rows());
+    }
+
+    int rows() const { return a.rows(); }
+    int cols() const { return b.cols(); }
+    bool refersTo(const void* p) const { return a.refersTo(p) || b.refersTo(p); }
+
+    const Matrix<T>& a;
+    const Matrix<T>& b;
+};
+
+template <typename E>
+struct HasProduct : std::false_type {};
+
+template <typename T>
+struct HasProduct<ProductExpr<T>> : std::true_type {};
+
+template <typename E>
+struct HasProduct<ScaleExpr<E>> : HasProduct<E> {};
+
+template <typename L, typename R, typename Op>
+struct HasProduct<BinaryExpr<L, R, Op>> : std::integral_constant<bool, HasProduct<L>::value || HasProduct<R>::value> {};
+
+template <typename E>
+struct IsZeroExpr : std::false_type {};
+
+template <typename T>
+struct IsZeroExpr<ZeroExpr<T>> : std::true_type {};
+
+template <typename L, typename R>
+BinaryExpr<L, R, PlusOp> operator+(const MatrixExpr<L>& l, const MatrixExpr<R>& r) {
+    return BinaryExpr<L, R, PlusOp>(l.self(), r.self());
+}
+
+template <typename L, typename R>
+BinaryExpr<L, R, MinusOp> operator-(const MatrixExpr<L>& l, const MatrixExpr<R>& r) {
+    return BinaryExpr<L, R, MinusOp>(l.self(), r.self());
+}
+
+template <typename E>
+ScaleExpr<E> operator*(typename E::value_type alpha, const MatrixExpr<E>& e) {
+    return ScaleExpr<E>(alpha, e.self());
+}
+
+template <typename E>
+ScaleExpr<E> operator*(const MatrixExpr<E>& e, typename E::value_type alpha) {
+    return ScaleExpr<E>(alpha, e.self());
+}
+
+template <typename E>
+ScaleExpr<E> operator-(const MatrixExpr<E>& e) {
+    return ScaleExpr<E>(typename E::value_type(-1), e.self());
+}
+
+template <typename T>
+ProductExpr<T> operator*(const Matrix<T>& a, const Matrix<T>& b) {
+    return ProductExpr<T>(a, b);
+}
+
+template <typename T>
+class Matrix : public MatrixExpr<Matrix<T>> {
+public:
+    typedef T value_type;
+
+    Matrix() = default;
+
+    // Элементы обнуляются параллельно, чтобы страницы попали к потокам, которые их обрабатывают
+    Matrix(int rows, int cols) : Matrix(rows, cols, T(0)) {}
+
+    Matrix(int rows, int cols, T value) {
+        resize(rows, cols);
+        fill(value);
+    }
+
+    Matrix(const Matrix& other) { evaluate(*this, other); }
+    Matrix(Matrix&& other) noexcept { swap(other); }
+
+    template <typename E>
+    Matrix(const MatrixExpr<E>& e) { evaluate(*this, e.self()); }
+
+    Matrix& operator=(const Matrix& other) {
+        if (this != &other)
+            evaluate(*this, other);
+        return *this;
+    }
+
+    Matrix& operator=(Matrix&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    template <typename E>
+    Matrix& operator=(const MatrixExpr<E>& e) {
+        evaluate(*this, e.self());
+        return *this;
+    }
+
+    template <typename E>
+    Matrix& operator+=(const MatrixExpr<E>& e) {
+        return *this = *this + e;
+    }
+
+    template <typename E>
+    Matrix& operator-=(const MatrixExpr<E>& e) {
+        return *this = *this - e;
+    }
+
+    // Новые элементы не инициализируются: их записывает тот, кто вызвал resize
+    void resize(int rows, int cols) {
+        data_.resize((size_t)rows * cols);
+        rows_ = rows;
+        cols_ = cols;
+    }
+
+    void fill(T value) {
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < rows_; ++i)
+            std::fill((*this)[i], (*this)[i] + cols_, value);
+    }
+
+    void swap(Matrix& other) noexcept {
+        std::swap(rows_, other.rows_);
+        std::swap(cols_, other.cols_);
+        data_.swap(other.data_);
+    }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int ld() const { return cols_; }
+    size_t size() const { return (size_t)rows_ * cols_; }
+    T* data() { return data_.data(); }
+    const T* data() const { return data_.data(); }
+
+    T* operator[](int i) { return data_.data() + (size_t)i * cols_; }
+    const T* operator[](int i) const { return data_.data() + (size_t)i * cols_; }
+    T& operator()(int i, int j) { return (*this)[i][j]; }
+    const T& operator()(int i, int j) const { return (*this)[i][j]; }
+
+    RowView<T> row(int i) { return RowView<T>((*this)[i], cols_); }
+    RowView<const T> row(int i) const { return RowView<const T>((*this)[i], cols_); }
+    ColView<T> col(int j) { return ColView<T>(data_.data() + j, rows_, cols_); }
+    ColView<const T> col(int j) const { return ColView<const T>(data_.data() + j, rows_, cols_); }
+
+    T at(int i, int j) const { return (*this)[i][j]; }
+    bool refersTo(const void* p) const { return p == this; }
+
+private:
+    int rows_ = 0, cols_ = 0;
+    AlignedArray<T> data_;
+};
+
+// Выражение с произведением, разобранное как alpha * a * b + rest
+template <typename T, typename Rest>
+struct ProductSplit {
+    const Matrix<T>& a;
+    const Matrix<T>& b;
+    T alpha;
+    Rest rest;
+};
+
+template <typename T, typename Rest>
+ProductSplit<T, Rest> makeSplit(const Matrix<T>& a, const Matrix<T>& b, T alpha, const Rest& rest) {
+    return ProductSplit<T, Rest>{ a, b, alpha, rest };
+}
+
+template <typename E>
+typename ExprStorage<E>::type exprLeaf(const E& e) {
+    return e;
+}
+
+// Поэлементная часть после отделения произведения; нулевые слагаемые отбрасываются
+template <typename Op, typename L, typename R>
+auto combineRest(const L& l, const R& r) {
+    typedef typename L::value_type T;
+    if constexpr (IsZeroExpr<R>::value)
+        return exprLeaf(l);
+    else if constexpr (IsZeroExpr<L>::value && std::is_same<Op, PlusOp>::value)
+        return exprLeaf(r);
+    else if constexpr (IsZeroExpr<L>::value)
+        return ScaleExpr<R>(T(-1), r);
+    else
+        return BinaryExpr<L, R, Op>(l, r);
+}
+
+template <typename E>
+auto scaleRest(typename E::value_type alpha, const E& rest) {
+    if constexpr (IsZeroExpr<E>::value)
+        return rest;
+    else
+        return ScaleExpr<E>(alpha, rest);
+}
+
+template <typename T>
+ProductSplit<T, ZeroExpr<T>> splitProduct(const ProductExpr<T>& p) {
+    return makeSplit(p.a, p.b, T(1), ZeroExpr<T>(p.rows(), p.cols()));
+}
+
+template <typename E>
+auto splitProduct(const ScaleExpr<E>& s) {
+    auto inner = splitProduct(s.e);
+    return makeSplit(inner.a, inner.b, s.alpha * inner.alpha, scaleRest(s.alpha, inner.rest));
+}
+
+template <typename L, typename R, typename Op>
+auto splitProduct(const BinaryExpr<L, R, Op>& e) {
+    static_assert(!(HasProduct<L>::value && HasProduct<R>::value), "only one matrix product per expression");
+    typedef typename L::value_type T;
+    if constexpr (HasProduct<L>::value) {
+        auto inner = splitProduct(e.l);
+        return makeSplit(inner.a, inner.b, inner.alpha, combineRest<Op>(inner.rest, e.r));
+    } else {
+        // l - (alpha * a * b + rest) = -alpha * a * b + (l - rest)
+        auto inner = splitProduct(e.r);
+        const T sign = std::is_same<Op, MinusOp>::value ? T(-1) : T(1);
+        return makeSplit(inner.a, inner.b, sign * inner.alpha, combineRest<Op>(e.l, inner.rest));
+    }
+}
+
+// Эпилог gemm: c = alpha * c + rest(i, j) для готовой плитки
+template <typename T, typename Rest>
+void productEpilogue(const void* ctx, int row0, int col0, T* C, int ldc, int rows, int cols) {
+    const auto& s = *static_cast<const ProductSplit<T, Rest>*>(ctx);
+    for (int r = 0; r < rows; ++r) {
+        T* c = C + (size_t)r * ldc;
+        for (int j = 0; j < cols; ++j) {
+            if constexpr (IsZeroExpr<Rest>::value)
+                c[j] = s.alpha * c[j];
+            else
+                c[j] = s.alpha * c[j] + s.rest.at(row0 + r, col0 + j);
+        }
+    }
+}
+
+template <typename T, typename Rest>
+void evaluateProduct(Matrix<T>& dest, const ProductSplit<T, Rest>& s) {
+    const int m = s.a.rows(), n = s.b.cols(), k = s.a.cols();
+    assert(s.rest.rows() == m && s.rest.cols() == n);
+    dest.resize(m, n);
+
+    if (IsZeroExpr<Rest>::value && s.alpha == T(1)) {
+        gemm(m, n, k, s.a.data(), s.a.ld(), s.b.data(), s.b.ld(), dest.data(), dest.ld());
+        return;
+    }
+    const GemmEpilogue<T> epilogue = { productEpilogue<T, Rest>, &s };
+    gemm(m, n, k, s.a.data(), s.a.ld(), s.b.data(), s.b.ld(), dest.data(), dest.ld(), T(0), &epilogue);
+}
+
+// Вычисление выражения в dest: с произведением - через gemm с эпилогом, иначе - один
+// параллельный проход по строкам
+template <typename T, typename E>
+void evaluate(Matrix<T>& dest, const E& e) {
+    if constexpr (HasProduct<E>::value) {
+        if (e.refersTo(&dest)) {
+            Matrix<T> result;
+            evaluateProduct(result, splitProduct(e));
+            dest.swap(result);
+        } else {
+            evaluateProduct(dest, splitProduct(e));
+        }
+    } else {
+        const int rows = e.rows(), cols = e.cols();
+        dest.resize(rows, cols);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < rows; ++i) {
+            T* d = dest[i];
+            for (int j = 0; j < cols; ++j)
+                d[j] = e.at(i, j);
+        }
+    }
+}
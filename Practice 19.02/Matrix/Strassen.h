@@ -0,0 +1,237 @@
+﻿#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include "Gemm.h"
+
+// Умножение по схеме Штрассена-Винограда: 7 умножений и 15 сложений блоков вместо 8 умножений.
+// На верхних уровнях рекурсии семь произведений выполняются задачами OpenMP, ниже - по очереди
+// с экономным расписанием Boyer-Dumas-Pernet-Zhou (два временных блока, остальное - в C).
+// Когда наименьшая размерность не больше cutoff, вызывается блочное gemm. Нечётные размеры
+// обрабатываются динамическим отсечением: рекурсия идёт по чётной части, а последние строка,
+// столбец и ранг-1 поправка по k досчитываются через gemm.
+// Вся временная память берётся из одного буфера, размер которого считается заранее.
+
+// Размер, ниже которого рекурсия переходит на gemm
+const int STRASSEN_CUTOFF = 512;
+
+struct StrassenConfig {
+    int cutoff;
+    int task_depth;  // число верхних уровней, на которых произведения идут задачами
+};
+
+inline bool strassenLeaf(int m, int k, int n, const StrassenConfig& cfg) {
+    return std::min(std::min(m, k), n) <= std::max(cfg.cutoff, 1);
+}
+
+// Число уровней рекурсии до перехода на gemm
+inline int strassenLevels(int m, int k, int n, const StrassenConfig& cfg) {
+    int levels = 0;
+    while (!strassenLeaf(m, k, n, cfg)) {
+        m /= 2;
+        k /= 2;
+        n /= 2;
+        ++levels;
+    }
+    return levels;
+}
+
+// Размер буфера в элементах: на параллельном уровне - 4 блока S, 4 блока T и 7 произведений
+// плюс отдельная память каждой из семи задач, на последовательном - блоки X и Y
+inline size_t strassenWorkspace(int m, int k, int n, const StrassenConfig& cfg, int depth) {
+    if (strassenLeaf(m, k, n, cfg))
+        return 0;
+    const size_t m2 = m / 2, k2 = k / 2, n2 = n / 2;
+    const size_t child = strassenWorkspace(m / 2, k / 2, n / 2, cfg, depth + 1);
+    if (depth < cfg.task_depth)
+        return 4 * m2 * k2 + 4 * k2 * n2 + 7 * m2 * n2 + 7 * child;
+    return m2 * std::max(k2, n2) + k2 * n2 + child;
+}
+
+// Z = X + sign * Y для блока m x n. На параллельных уровнях строки делятся между задачами
+// taskloop, который сам дожидается своих задач
+template <typename T>
+void addBlocks(int m, int n, const T* X, int ldx, const T* Y, int ldy, T* Z, int ldz, T sign, bool tasks) {
+    auto row = [&](int i) {
+        const T* x = X + (size_t)i * ldx;
+        const T* y = Y + (size_t)i * ldy;
+        T* z = Z + (size_t)i * ldz;
+        for (int j = 0; j < n; ++j)
+            z[j] = x[j] + sign * y[j];
+    };
+
+    if (tasks) {
+#pragma omp taskloop grainsize(16)
+        for (int i = 0; i < m; ++i)
+            row(i);
+    } else {
+        for (int i = 0; i < m; ++i)
+            row(i);
+    }
+}
+
+template <typename T>
+void strassenRecursive(int m, int k, int n, const T* A, int lda, const T* B, int ldb, T* C, int ldc, T* work,
+    const StrassenConfig& cfg, int depth);
+
+// Один уровень с задачами: все S и T считаются заранее, семь произведений независимы
+template <typename T>
+void strassenParallelStep(int m2, int k2, int n2, const T* A, int lda, const T* B, int ldb, T* C, int ldc, T* work,
+    const StrassenConfig& cfg, int depth) {
+    const T* A11 = A;
+    const T* A12 = A + k2;
+    const T* A21 = A + (size_t)m2 * lda;
+    const T* A22 = A21 + k2;
+    const T* B11 = B;
+    const T* B12 = B + n2;
+    const T* B21 = B + (size_t)k2 * ldb;
+    const T* B22 = B21 + n2;
+    T* C11 = C;
+    T* C12 = C + n2;
+    T* C21 = C + (size_t)m2 * ldc;
+    T* C22 = C21 + n2;
+
+    const size_t sa = (size_t)m2 * k2, sb = (size_t)k2 * n2, sc = (size_t)m2 * n2;
+    T* S[4];
+    T* Tb[4];
+    T* P[7];
+    for (int i = 0; i < 4; ++i)
+        S[i] = work + i * sa;
+    for (int i = 0; i < 4; ++i)
+        Tb[i] = work + 4 * sa + i * sb;
+    for (int i = 0; i < 7; ++i)
+        P[i] = work + 4 * sa + 4 * sb + i * sc;
+    T* child_work = work + 4 * sa + 4 * sb + 7 * sc;
+    const size_t child_size = strassenWorkspace(m2, k2, n2, cfg, depth + 1);
+
+    // S1 = A21 + A22, S2 = S1 - A11, S3 = A11 - A21, S4 = A12 - S2
+    addBlocks(m2, k2, A21, lda, A22, lda, S[0], k2, T(1), true);
+    addBlocks(m2, k2, S[0], k2, A11, lda, S[1], k2, T(-1), true);
+    addBlocks(m2, k2, A11, lda, A21, lda, S[2], k2, T(-1), true);
+    addBlocks(m2, k2, A12, lda, S[1], k2, S[3], k2, T(-1), true);
+    // T1 = B12 - B11, T2 = B22 - T1, T3 = B22 - B12, T4 = T2 - B21
+    addBlocks(k2, n2, B12, ldb, B11, ldb, Tb[0], n2, T(-1), true);
+    addBlocks(k2, n2, B22, ldb, Tb[0], n2, Tb[1], n2, T(-1), true);
+    addBlocks(k2, n2, B22, ldb, B12, ldb, Tb[2], n2, T(-1), true);
+    addBlocks(k2, n2, Tb[1], n2, B21, ldb, Tb[3], n2, T(-1), true);
+
+    // P1 = A11 B11, P2 = A12 B21, P3 = S4 B22, P4 = A22 T4, P5 = S1 T1, P6 = S2 T2, P7 = S3 T3
+    const T* lhs[7] = { A11, A12, S[3], A22, S[0], S[1], S[2] };
+    const int ldl[7] = { lda, lda, k2, lda, k2, k2, k2 };
+    const T* rhs[7] = { B11, B21, B22, Tb[3], Tb[0], Tb[1], Tb[2] };
+    const int ldr[7] = { ldb, ldb, ldb, n2, n2, n2, n2 };
+    for (int i = 0; i < 7; ++i) {
+#pragma omp task firstprivate(i)
+        strassenRecursive(m2, k2, n2, lhs[i], ldl[i], rhs[i], ldr[i], P[i], n2, child_work + i * child_size, cfg,
+            depth + 1);
+    }
+#pragma omp taskwait
+
+    // U2 = P1 + P6, U3 = U2 + P7, C22 = U3 + P5, U4 = U2 + P5, C12 = U4 + P3, C21 = U3 - P4, C11 = P1 + P2
+    addBlocks(m2, n2, P[5], n2, P[0], n2, P[5], n2, T(1), true);
+    addBlocks(m2, n2, P[6], n2, P[5], n2, P[6], n2, T(1), true);
+    addBlocks(m2, n2, P[6], n2, P[4], n2, C22, ldc, T(1), true);
+    addBlocks(m2, n2, P[4], n2, P[5], n2, P[4], n2, T(1), true);
+    addBlocks(m2, n2, P[4], n2, P[2], n2, C12, ldc, T(1), true);
+    addBlocks(m2, n2, P[6], n2, P[3], n2, C21, ldc, T(-1), true);
+    addBlocks(m2, n2, P[0], n2, P[1], n2, C11, ldc, T(1), true);
+}
+
+// Последовательный уровень: расписание из 22 шагов с временными блоками X (m2 x max(k2, n2))
+// и Y (k2 x n2), промежуточные произведения хранятся в четвертях C
+template <typename T>
+void strassenSequentialStep(int m2, int k2, int n2, const T* A, int lda, const T* B, int ldb, T* C, int ldc,
+    T* work, const StrassenConfig& cfg, int depth) {
+    const T* A11 = A;
+    const T* A12 = A + k2;
+    const T* A21 = A + (size_t)m2 * lda;
+    const T* A22 = A21 + k2;
+    const T* B11 = B;
+    const T* B12 = B + n2;
+    const T* B21 = B + (size_t)k2 * ldb;
+    const T* B22 = B21 + n2;
+    T* C11 = C;
+    T* C12 = C + n2;
+    T* C21 = C + (size_t)m2 * ldc;
+    T* C22 = C21 + n2;
+
+    T* X = work;
+    T* Y = work + (size_t)m2 * std::max(k2, n2);
+    T* child = Y + (size_t)k2 * n2;
+    const int ldx = k2, ldy = n2;
+
+    auto multiply = [&](const T* L, int ldl, const T* R, int ldr, T* out, int ldo) {
+        strassenRecursive(m2, k2, n2, L, ldl, R, ldr, out, ldo, child, cfg, depth + 1);
+    };
+
+    addBlocks(m2, k2, A11, lda, A21, lda, X, ldx, T(-1), false);   // S3 = A11 - A21
+    addBlocks(k2, n2, B22, ldb, B12, ldb, Y, ldy, T(-1), false);   // T3 = B22 - B12
+    multiply(X, ldx, Y, ldy, C21, ldc);                             // P7 = S3 T3
+    addBlocks(m2, k2, A21, lda, A22, lda, X, ldx, T(1), false);    // S1 = A21 + A22
+    addBlocks(k2, n2, B12, ldb, B11, ldb, Y, ldy, T(-1), false);   // T1 = B12 - B11
+    multiply(X, ldx, Y, ldy, C22, ldc);                             // P5 = S1 T1
+    addBlocks(k2, n2, B22, ldb, Y, ldy, Y, ldy, T(-1), false);     // T2 = B22 - T1
+    addBlocks(m2, k2, X, ldx, A11, lda, X, ldx, T(-1), false);     // S2 = S1 - A11
+    multiply(X, ldx, Y, ldy, C12, ldc);                             // P6 = S2 T2
+    addBlocks(m2, k2, A12, lda, X, ldx, X, ldx, T(-1), false);     // S4 = A12 - S2
+    multiply(X, ldx, B22, ldb, C11, ldc);                           // P3 = S4 B22
+    multiply(A11, lda, B11, ldb, X, n2);                            // P1 = A11 B11
+    addBlocks(m2, n2, X, n2, C12, ldc, C12, ldc, T(1), false);     // U2 = P1 + P6
+    addBlocks(m2, n2, C12, ldc, C21, ldc, C21, ldc, T(1), false);  // U3 = U2 + P7
+    addBlocks(m2, n2, C12, ldc, C22, ldc, C12, ldc, T(1), false);  // U4 = U2 + P5
+    addBlocks(m2, n2, C21, ldc, C22, ldc, C22, ldc, T(1), false);  // U7 = U3 + P5
+    addBlocks(m2, n2, C12, ldc, C11, ldc, C12, ldc, T(1), false);  // U5 = U4 + P3
+    addBlocks(k2, n2, Y, ldy, B21, ldb, Y, ldy, T(-1), false);     // T4 = T2 - B21
+    multiply(A22, lda, Y, ldy, C11, ldc);                           // P4 = A22 T4
+    addBlocks(m2, n2, C21, ldc, C11, ldc, C21, ldc, T(-1), false); // U6 = U3 - P4
+    multiply(A12, lda, B21, ldb, C11, ldc);                         // P2 = A12 B21
+    addBlocks(m2, n2, X, n2, C11, ldc, C11, ldc, T(1), false);     // U1 = P1 + P2
+}
+
+template <typename T>
+void strassenRecursive(int m, int k, int n, const T* A, int lda, const T* B, int ldb, T* C, int ldc, T* work,
+    const StrassenConfig& cfg, int depth) {
+    if (strassenLeaf(m, k, n, cfg)) {
+        gemm(m, n, k, A, lda, B, ldb, C, ldc);
+        return;
+    }
+
+    const int m2 = m / 2, k2 = k / 2, n2 = n / 2;
+    if (depth < cfg.task_depth)
+        strassenParallelStep(m2, k2, n2, A, lda, B, ldb, C, ldc, work, cfg, depth);
+    else
+        strassenSequentialStep(m2, k2, n2, A, lda, B, ldb, C, ldc, work, cfg, depth);
+
+    // Динамическое отсечение нечётных размерностей
+    const int me = 2 * m2, ke = 2 * k2, ne = 2 * n2;
+    if (ke < k)
+        gemm(me, ne, 1, A + ke, lda, B + (size_t)ke * ldb, ldb, C, ldc, T(1));
+    if (ne < n)
+        gemm(m, 1, k, A, lda, B + ne, ldb, C + ne, ldc);
+    if (me < m)
+        gemm(1, ne, k, A + (size_t)me * lda, lda, B, ldb, C + (size_t)me * ldc, ldc);
+}
+
+// C (m x n) = A (m x k) * B (k x n) по Штрассену-Винограду.
+// Задачи запускаются на стольких верхних уровнях, чтобы 7^depth хватило на все потоки
+template <typename T>
+void strassen(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C, int ldc,
+    int cutoff = STRASSEN_CUTOFF) {
+    StrassenConfig cfg = { cutoff, 0 };
+    const int levels = strassenLevels(m, k, n, cfg);
+    const int threads = omp_get_max_threads();
+    for (int tasks = 1; tasks < threads && cfg.task_depth < levels; tasks *= 7)
+        ++cfg.task_depth;
+
+    AlignedArray<T> arena(std::max<size_t>(strassenWorkspace(m, k, n, cfg, 0), 1));
+
+    if (cfg.task_depth == 0) {
+        strassenRecursive(m, k, n, A, lda, B, ldb, C, ldc, arena.data(), cfg, 0);
+        return;
+    }
+
+#pragma omp parallel
+#pragma omp single
+    strassenRecursive(m, k, n, A, lda, B, ldb, C, ldc, arena.data(), cfg, 0);
+}
@@ -0,0 +1,220 @@
+﻿#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "../../Practice 19.02/Matrix/Gemm.h"
+
+// Интегрирование с пакетной подынтегральной функцией: f(x, y, count) считает y[i] = f(x[i])
+// сразу для массива точек, поэтому функция может быть векторной (как sinhBatch ниже) и не
+// платит за вызов на каждую точку. Сумма детерминирована: точки делятся на блоки по
+// INTEGRAL_BLOCK независимо от числа потоков, блок суммируется попарно, а суммы блоков
+// складываются по порядку номеров с компенсацией Ноймайера. Какой поток считал какой блок -
+// не важно, поэтому результат побитово одинаков при любом числе потоков.
+// Компенсированное суммирование ломается от -ffast-math (перестановка сложений), как и в STREAM.
+
+// Точек в блоке: массивы x и y блока помещаются в L1
+const int INTEGRAL_BLOCK = 2048;
+// Длина участка, который суммируется напрямую, при попарном суммировании
+const int PAIRWISE_BASE = 128;
+// До этого |x| работает векторная формула sinh, дальше - std::sinh (там уже переполнение)
+const double SINH_VECTOR_LIMIT = 708.0;
+
+#if defined(__GNUC__)
+
+// Векторные типы шириной Bytes: typedef с атрибутом теряет его, если передать тип
+// параметром шаблона, поэтому ширина передаётся числом
+template <int Bytes>
+struct SimdDouble {
+    typedef double V __attribute__((vector_size(Bytes)));
+    typedef double VU __attribute__((vector_size(Bytes), aligned(8), may_alias));
+    typedef long long I __attribute__((vector_size(Bytes)));
+};
+
+// sinh для вектора: при |x| < 1 - ряд Тейлора до x^17 (нет потери точности при e^x - e^-x),
+// иначе (e^|x| - e^-|x|) / 2. e^a: a = k ln2 + r, |r| <= ln2 / 2, e^r - многочлен степени 13,
+// 2^k собирается прямо в битах показателя
+template <int Bytes>
+GEMM_INLINE void sinhVector(const double* x, double* y) {
+    typedef typename SimdDouble<Bytes>::V V;
+    typedef typename SimdDouble<Bytes>::VU VU;
+    typedef typename SimdDouble<Bytes>::I I;
+    const V v = *(const VU*)x;
+    const V zero = V{};
+    const V a = v < zero ? -v : v;
+
+    const V x2 = a * a;
+    V small = zero + 1.0 / 355687428096000.0;  // 1/17!
+    small = small * x2 + 1.0 / 1307674368000.0;
+    small = small * x2 + 1.0 / 6227020800.0;
+    small = small * x2 + 1.0 / 39916800.0;
+    small = small * x2 + 1.0 / 362880.0;
+    small = small * x2 + 1.0 / 5040.0;
+    small = small * x2 + 1.0 / 120.0;
+    small = small * x2 + 1.0 / 6.0;
+    small = a + a * x2 * small;
+
+    const V limit = zero + SINH_VECTOR_LIMIT;
+    const V clamped = a > limit ? limit : a;
+    // Прибавление 1.5 * 2^52 округляет до целого, и это целое оказывается в младших битах
+    const V shifter = zero + 6755399441055744.0;
+    const V t = clamped * 1.4426950408889634 + shifter;
+    const V k = t - shifter;
+    V r = clamped - k * 6.93147180369123816490e-01;
+    r = r - k * 1.90821492927058770002e-10;
+
+    V p = zero + 1.0 / 6227020800.0;  // 1/13!
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+
+    const I scale_bits = ((I)t + 1023) << 52;
+    const V e = p * (V)scale_bits;
+    const V large = 0.5 * (e - 1.0 / e);
+
+    const V result = a < zero + 1.0 ? small : large;
+    *(VU*)y = v < zero ? -result : result;
+}
+
+template <int Bytes>
+GEMM_INLINE void sinhKernel(const double* x, double* y, int count) {
+    constexpr int L = Bytes / sizeof(double);
+
+    int i = 0;
+    for (; i + L <= count; i += L)
+        sinhVector<Bytes>(x + i, y + i);
+
+    // Хвост - через буфер, той же формулой, что и полные векторы
+    if (i < count) {
+        double in[L] = {}, out[L];
+        std::copy(x + i, x + count, in);
+        sinhVector<Bytes>(in, out);
+        std::copy(out, out + (count - i), y + i);
+    }
+
+    for (int j = 0; j < count; ++j)
+        if (std::fabs(x[j]) > SINH_VECTOR_LIMIT)
+            y[j] = std::sinh(x[j]);
+}
+
+#else
+
+template <int Bytes>
+inline void sinhKernel(const double* x, double* y, int count) {
+    for (int i = 0; i < count; ++i)
+        y[i] = std::sinh(x[i]);
+}
+
+#endif
+
+typedef void (*SinhBatchFn)(const double*, double*, int);
+
+inline void sinhBatchGeneric(const double* x, double* y, int count) {
+    sinhKernel<16>(x, y, count);
+}
+
+#ifdef GEMM_X86
+__attribute__((target("avx2,fma"))) inline void sinhBatchAvx2(const double* x, double* y, int count) {
+    sinhKernel<32>(x, y, count);
+}
+
+__attribute__((target("avx512f"))) inline void sinhBatchAvx512(const double* x, double* y, int count) {
+    sinhKernel<64>(x, y, count);
+}
+#endif
+
+inline SinhBatchFn selectSinhBatch(GemmIsa isa) {
+#ifdef GEMM_X86
+    if (isa == GemmIsa::AVX512)
+        return sinhBatchAvx512;
+    if (isa == GemmIsa::AVX2)
+        return sinhBatchAvx2;
+#endif
+    (void)isa;
+    return sinhBatchGeneric;
+}
+
+// y[i] = sinh(x[i]) для count точек
+inline void sinhBatch(const double* x, double* y, int count) {
+    static const SinhBatchFn kernel = selectSinhBatch(gemmIsa());
+    kernel(x, y, count);
+}
+
+// Компенсированное суммирование Каэна-Ноймайера: потерянные при сложении младшие биты
+// копятся отдельно, погрешность не растёт с числом слагаемых
+struct NeumaierSum {
+    double sum = 0, compensation = 0;
+
+    void add(double value) {
+        const double t = sum + value;
+        if (std::fabs(sum) >= std::fabs(value))
+            compensation += (sum - t) + value;
+        else
+            compensation += (value - t) + sum;
+        sum = t;
+    }
+
+    double result() const { return sum + compensation; }
+};
+
+// Попарное суммирование: погрешность растёт как log n. Короткие участки - восемью
+// независимыми суммами в фиксированном порядке, так что порядок сложений зависит только от n
+inline double pairwiseSum(const double* values, size_t n) {
+    if (n <= (size_t)PAIRWISE_BASE) {
+        double acc[8] = {};
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            for (int j = 0; j < 8; ++j)
+                acc[j] += values[i + j];
+        for (int j = 0; i < n; ++i, ++j)
+            acc[j] += values[i];
+        return ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+    }
+    const size_t half = n / 2;
+    return pairwiseSum(values, half) + pairwiseSum(values + half, n - half);
+}
+
+// Метод средних прямоугольников с n отрезками на [a, b]; threads = 0 - omp_get_max_threads()
+template <typename F>
+double integrateMidpoint(const F& f, double a, double b, long long n, int threads = 0) {
+    if (threads <= 0)
+        threads = omp_get_max_threads();
+    const double dx = (b - a) / n;
+    const long long blocks = (n + INTEGRAL_BLOCK - 1) / INTEGRAL_BLOCK;
+    std::vector<double> block_sums(blocks);
+
+#pragma omp parallel num_threads(threads)
+    {
+        AlignedArray<double> xs(INTEGRAL_BLOCK), ys(INTEGRAL_BLOCK);
+        double* x = xs.data();
+        double* y = ys.data();
+
+#pragma omp for schedule(static)
+        for (long long block = 0; block < blocks; ++block) {
+            const long long first = block * INTEGRAL_BLOCK;
+            const int count = (int)std::min<long long>(INTEGRAL_BLOCK, n - first);
+            for (int i = 0; i < count; ++i)
+                x[i] = a + ((double)(first + i) + 0.5) * dx;
+            f(x, y, count);
+            block_sums[block] = pairwiseSum(y, count);
+        }
+    }
+
+    // Суммы блоков - по порядку номеров, поэтому от числа потоков ничего не зависит
+    NeumaierSum total;
+    for (double s : block_sums)
+        total.add(s);
+    return total.result() * dx;
+}
@@ -2,7 +2,11 @@
 #include <cmath>
 #include <vector>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <omp.h>
+#include "Quadrature.h"
+#include "BatchIntegral.h"
 
 using namespace std;
 using namespace chrono;
@@ -12,6 +16,11 @@ double f(double x) {
     return sinh(x);
 }
 
+// Пакетная версия f: sinh сразу для массива точек векторной формулой
+void f_batch(const double* x, double* y, int count) {
+    sinhBatch(x, y, count);
+}
+
 // Последовательное численное интегрирование методом средних прямоугольников
 double integral_seq(double a, double b, int n) {
     double sum = 0.0;
@@ -50,6 +59,62 @@ double integral_par(double a, double b, int n) {
     return sum * dx;
 }
 
+// Точная сумма того же метода средних прямоугольников: std::sinh в long double и
+// компенсированное сложение в long double - эталон для ошибки суммирования
+double midpoint_reference(double a, double b, int n) {
+    long double sum = 0, compensation = 0;
+    double dx = (b - a) / n;
+    for (int i = 0; i < n; ++i) {
+        long double value = sinhl(a + ((double)i + 0.5) * dx);
+        long double t = sum + value;
+        compensation += fabsl(sum) >= fabsl(value) ? (sum - t) + value : (value - t) + sum;
+        sum = t;
+    }
+    return (double)((sum + compensation) * dx);
+}
+
+// Наибольшая относительная ошибка sinhBatch по сравнению с std::sinh на [lo, hi]
+double sinh_batch_error(double lo, double hi, int points) {
+    vector<double> x(points), y(points);
+    for (int i = 0; i < points; ++i)
+        x[i] = lo + (hi - lo) * i / (points - 1);
+    sinhBatch(x.data(), y.data(), points);
+    double error = 0;
+    for (int i = 0; i < points; ++i)
+        if (x[i] != 0)
+            error = max(error, fabs(y[i] - sinh(x[i])) / fabs(sinh(x[i])));
+    return error;
+}
+
+// Интегралы с известным значением для адаптивного метода: гладкий, с особенностью
+// производной на конце, с узким пиком и быстро колеблющийся
+struct TestIntegral {
+    const char* name;
+    double (*f)(double);
+    double a, b;
+    double exact;
+};
+
+double sqrt_x(double x) { return sqrt(x); }
+double narrow_peak(double x) { return 1 / (1e-4 + x * x); }
+double oscillating(double x) { return x * sin(30 * x); }
+
+// Адаптивный G7/K15 на одном и на всех потоках: вычисления, отрезки и время до точности tolerance
+void adaptive_report(const TestIntegral& test, double tolerance) {
+    QuadratureOptions options;
+    options.absolute_tolerance = 0;
+    options.relative_tolerance = tolerance;
+
+    options.threads = 1;
+    QuadratureResult seq = adaptiveIntegrate(test.f, test.a, test.b, options);
+    options.threads = 0;
+    QuadratureResult par = adaptiveIntegrate(test.f, test.a, test.b, options);
+
+    printf("%-12s %8.0e %22.16g %10.2e %10.2e %8lld %6d %3s %9.3f %9.3f\n", test.name, tolerance, par.value,
+        fabs(par.value - test.exact) / fabs(test.exact), par.error / fabs(par.value), par.evaluations, par.intervals,
+        par.converged ? "yes" : "no", seq.seconds * 1000, par.seconds * 1000);
+}
+
 int main() {
     double a = 0.0, b = 4.0; // Интервал интегрирования от 0 до 4
     int n = 10000000; // Количество разбиений
@@ -86,5 +151,53 @@ int main() {
     cout << "Time difference: " << abs(time_seq - time_par) << " ms" << endl;
     cout << "Speedup: " << speedup << "x" << endl;
 
+    // Пакетная функция, попарные суммы блоков и компенсированное сложение сумм блоков
+    double reference = midpoint_reference(a, b, n);
+
+    auto start_batch_seq = high_resolution_clock::now();
+    double batch_seq = integrateMidpoint(f_batch, a, b, n, 1);
+    double time_batch_seq = duration<double, milli>(high_resolution_clock::now() - start_batch_seq).count();
+
+    auto start_batch_par = high_resolution_clock::now();
+    double batch_par = integrateMidpoint(f_batch, a, b, n);
+    double time_batch_par = duration<double, milli>(high_resolution_clock::now() - start_batch_par).count();
+
+    printf("\nBatch integrand (%s sinh), pairwise + Neumaier summation\n", gemmIsaName(gemmIsa()));
+    printf("sinhBatch max relative error vs std::sinh: %.2e\n", sinh_batch_error(-20, 20, 1000001));
+    printf("Midpoint sum reference (long double): %.17g\n", reference);
+    printf("Batch result: %.17g (sequential), %.17g (parallel)\n", batch_seq, batch_par);
+    printf("Summation error vs reference: naive %.2e, batch %.2e\n", fabs(seq_result - reference) / reference,
+        fabs(batch_seq - reference) / reference);
+    printf("Batch sequential time: %.2f ms\n", time_batch_seq);
+    printf("Batch parallel time: %.2f ms\n", time_batch_par);
+    printf("Speedup vs scalar sequential: %.1fx (1 thread), %.1fx (%d threads)\n", time_seq / time_batch_seq,
+        time_seq / time_batch_par, omp_get_max_threads());
+
+    // Результат не должен зависеть от числа потоков ни в одном бите
+    int max_threads = max(8, omp_get_max_threads());
+    bool identical = true;
+    for (int threads = 1; threads <= max_threads; ++threads) {
+        double value = integrateMidpoint(f_batch, a, b, n, threads);
+        identical = identical && memcmp(&value, &batch_seq, sizeof(double)) == 0;
+    }
+    printf("Results for 1..%d threads are %s\n", max_threads, identical ? "bitwise identical" : "different (error)");
+
+    // Адаптивный Гаусс-Кронрод: сколько вычислений нужно для заданной относительной точности.
+    // Ошибки - относительные: фактическая и оценка метода
+    vector<TestIntegral> tests = {
+        { "sinh", f, a, b, analytic_result },
+        { "sqrt", sqrt_x, 0, 1, 2.0 / 3 },
+        { "peak", narrow_peak, -1, 1, 200 * atan(100.0) },
+        { "x sin(30x)", oscillating, 0, 2 * M_PI, -M_PI / 15 },
+    };
+    printf("\nAdaptive Gauss-Kronrod G7/K15 (%d threads), midpoint rule above: %d evaluations\n", omp_get_max_threads(), n);
+    printf("%-12s %8s %22s %10s %10s %8s %6s %3s %9s %9s\n", "integrand", "tol", "value", "error", "estimate", "evals",
+        "parts", "ok", "1 thr ms", "all ms");
+    for (double tolerance : { 1e-4, 1e-8, 1e-12 })
+        adaptive_report(tests[0], tolerance);
+    for (size_t i = 1; i < tests.size(); ++i)
+        for (double tolerance : { 1e-6, 1e-10 })
+            adaptive_report(tests[i], tolerance);
+
     return 0;
 }
@@ -0,0 +1,199 @@
+﻿#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+// Адаптивное интегрирование Гаусса-Кронрода (G7/K15): на отрезке считаются 15-точечная
+// формула Кронрода и вложенная в неё 7-точечная формула Гаусса, их разница даёт оценку
+// погрешности (по правилу QUADPACK). Отрезки лежат в общей очереди с приоритетом по
+// погрешности: каждый поток берёт худший отрезок, делит пополам и возвращает обе половины.
+// Работа заканчивается, когда суммарная оценка погрешности не больше
+// max(absolute_tolerance, relative_tolerance * |I|) или отрезков стало max_intervals.
+// Подынтегральная функция - любой вызываемый объект double(double), безопасный для
+// вызова из нескольких потоков.
+
+// Узлы формулы Кронрода на [-1, 1] (неотрицательные, по убыванию); нечётные - узлы Гаусса
+const double KRONROD_NODES[8] = {
+    0.991455371120812639206854697526329,
+    0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926,
+    0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013,
+    0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245,
+    0.000000000000000000000000000000000,
+};
+
+const double KRONROD_WEIGHTS[8] = {
+    0.022935322010529224963732008058970,
+    0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518,
+    0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550,
+    0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649,
+    0.209482141084727828012999174891714,
+};
+
+// Веса Гаусса для узлов KRONROD_NODES[1], [3], [5] и центра
+const double GAUSS_WEIGHTS[4] = {
+    0.129484966168869693270611432679082,
+    0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975,
+    0.417959183673469387755102040816327,
+};
+
+// Вызовов функции на один отрезок
+const int KRONROD_POINTS = 15;
+
+struct QuadratureInterval {
+    double a, b;
+    double integral, error;
+
+    // Для очереди с приоритетом: наверху - отрезок с наибольшей погрешностью
+    bool operator<(const QuadratureInterval& other) const { return error < other.error; }
+};
+
+struct QuadratureOptions {
+    double absolute_tolerance = 1e-10;
+    double relative_tolerance = 1e-10;
+    int max_intervals = 100000;
+    int threads = 0;   // 0 - omp_get_max_threads()
+};
+
+struct QuadratureResult {
+    double value = 0;
+    double error = 0;         // оценка погрешности
+    long long evaluations = 0;
+    int intervals = 0;
+    bool converged = false;
+    double seconds = 0;
+};
+
+// Формула G7/K15 на [a, b]: значение K15 и оценка погрешности, как в QUADPACK qk15
+template <typename F>
+QuadratureInterval gaussKronrod15(const F& f, double a, double b) {
+    const double center = 0.5 * (a + b), half = 0.5 * (b - a);
+    const double f_center = f(center);
+
+    double kronrod = f_center * KRONROD_WEIGHTS[7];
+    double gauss = f_center * GAUSS_WEIGHTS[3];
+    double abs_sum = std::fabs(kronrod);
+    double values[14];
+    for (int j = 0; j < 7; ++j) {
+        const double dx = half * KRONROD_NODES[j];
+        const double f1 = f(center - dx), f2 = f(center + dx);
+        values[2 * j] = f1;
+        values[2 * j + 1] = f2;
+        kronrod += KRONROD_WEIGHTS[j] * (f1 + f2);
+        abs_sum += KRONROD_WEIGHTS[j] * (std::fabs(f1) + std::fabs(f2));
+        if (j % 2 == 1)
+            gauss += GAUSS_WEIGHTS[j / 2] * (f1 + f2);
+    }
+
+    // Среднее отклонение от среднего значения - масштаб для оценки погрешности
+    const double mean = 0.5 * kronrod;
+    double deviation = KRONROD_WEIGHTS[7] * std::fabs(f_center - mean);
+    for (int j = 0; j < 7; ++j)
+        deviation += KRONROD_WEIGHTS[j] * (std::fabs(values[2 * j] - mean) + std::fabs(values[2 * j + 1] - mean));
+
+    const double result = kronrod * half;
+    const double abs_result = abs_sum * std::fabs(half);
+    const double scale = deviation * std::fabs(half);
+    double error = std::fabs((kronrod - gauss) * half);
+    if (scale != 0 && error != 0)
+        error = scale * std::min(1.0, std::pow(200 * error / scale, 1.5));
+    const double epsilon = std::numeric_limits<double>::epsilon();
+    if (abs_result > std::numeric_limits<double>::min() / (50 * epsilon))
+        error = std::max(50 * epsilon * abs_result, error);
+    return { a, b, result, error };
+}
+
+// Адаптивное интегрирование f на [a, b]. Начальный отрезок делится на столько частей,
+// сколько потоков, дальше потоки работают с общей очередью; сумма и погрешность
+// обновляются под тем же мьютексом, а в конце пересчитываются по всем отрезкам очереди
+template <typename F>
+QuadratureResult adaptiveIntegrate(const F& f, double a, double b, const QuadratureOptions& options = {}) {
+    const int threads = options.threads > 0 ? options.threads : omp_get_max_threads();
+    const double start = omp_get_wtime();
+
+    std::vector<QuadratureInterval> initial(threads);
+#pragma omp parallel for num_threads(threads)
+    for (int i = 0; i < threads; ++i)
+        initial[i] = gaussKronrod15(f, a + (b - a) * i / threads, i + 1 == threads ? b : a + (b - a) * (i + 1) / threads);
+
+    std::priority_queue<QuadratureInterval> queue;
+    double total = 0, total_error = 0;
+    for (const QuadratureInterval& interval : initial) {
+        queue.push(interval);
+        total += interval.integral;
+        total_error += interval.error;
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    int in_flight = 0;
+    bool done = false, converged = false;
+    long long evaluations = (long long)threads * KRONROD_POINTS;
+
+#pragma omp parallel num_threads(threads)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            // Отрезки в работе ещё учтены своей старой погрешностью, поэтому условие не
+            // сработает раньше времени
+            if (!done && total_error <= std::max(options.absolute_tolerance, options.relative_tolerance * std::fabs(total))) {
+                done = true;
+                converged = true;
+            }
+            if (!done && (int)queue.size() + in_flight >= options.max_intervals)
+                done = true;
+            if (!done && queue.empty() && in_flight == 0)
+                done = true;
+            if (done) {
+                changed.notify_all();
+                break;
+            }
+            if (queue.empty()) {
+                changed.wait(lock);
+                continue;
+            }
+
+            const QuadratureInterval worst = queue.top();
+            queue.pop();
+            ++in_flight;
+            lock.unlock();
+
+            const double middle = 0.5 * (worst.a + worst.b);
+            const QuadratureInterval left = gaussKronrod15(f, worst.a, middle);
+            const QuadratureInterval right = gaussKronrod15(f, middle, worst.b);
+
+            lock.lock();
+            queue.push(left);
+            queue.push(right);
+            total += left.integral + right.integral - worst.integral;
+            total_error += left.error + right.error - worst.error;
+            evaluations += 2 * KRONROD_POINTS;
+            --in_flight;
+            changed.notify_all();
+        }
+    }
+
+    QuadratureResult result;
+    result.intervals = (int)queue.size();
+    while (!queue.empty()) {
+        result.value += queue.top().integral;
+        result.error += queue.top().error;
+        queue.pop();
+    }
+    result.evaluations = evaluations;
+    result.converged = converged;
+    result.seconds = omp_get_wtime() - start;
+    return result;
+}
@@ -0,0 +1,187 @@
+﻿#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include "../../Practice 19.02/Matrix/Matrix.h"
+
+// Умножение матрицы на пакет векторов: y_v = A x_v для v = 0..k-1. Векторы - строки
+// матриц X (k x n) и Y (k x m). Умножение на вектор упирается в память, поэтому строка A
+// читается из памяти один раз для всех k векторов: ядро берёт плитку из GEMV_ROWS строк и
+// нескольких векторов, каждая загрузка x используется для всех строк плитки, каждая
+// загрузка A - для всех векторов, а аккумуляторов R * K хватает, чтобы сложения шли
+// независимыми цепочками. Следующие группы векторов берут те же строки уже из L2.
+// Ядро собирается под AVX2 и AVX-512 через атрибут target, как gemm.
+// Блоки строк делятся между потоками по schedule(static) - почти так же, как строки при
+// обнулении в конструкторе Matrix, поэтому поток читает страницы, которых сам коснулся
+// первым (на многосокетной машине - память своего узла NUMA). Каждый поток пишет свои
+// элементы y, атомарные операции не нужны.
+
+// Строк в плитке ядра
+const int GEMV_ROWS = 4;
+
+#if defined(__GNUC__)
+
+// Плитка R строк x K векторов; y[v * ldy + r] - результат строки r для вектора v
+template <int Bytes, int R, int K>
+GEMM_INLINE void gemvTile(int n, const double* a, int lda, const double* X, int ldx, double* y, int ldy) {
+    typedef double V __attribute__((vector_size(Bytes)));
+    typedef double VU __attribute__((vector_size(Bytes), aligned(8), may_alias));
+    constexpr int L = Bytes / sizeof(double);
+
+    V acc[R][K];
+#pragma GCC unroll 4
+    for (int r = 0; r < R; ++r)
+#pragma GCC unroll 4
+        for (int v = 0; v < K; ++v)
+            acc[r][v] = V{};
+
+    int j = 0;
+    for (; j + L <= n; j += L) {
+        V av[R];
+#pragma GCC unroll 4
+        for (int r = 0; r < R; ++r)
+            av[r] = *(const VU*)(a + (size_t)r * lda + j);
+#pragma GCC unroll 4
+        for (int v = 0; v < K; ++v) {
+            const V xv = *(const VU*)(X + (size_t)v * ldx + j);
+#pragma GCC unroll 4
+            for (int r = 0; r < R; ++r)
+                acc[r][v] += av[r] * xv;
+        }
+    }
+
+    for (int r = 0; r < R; ++r)
+        for (int v = 0; v < K; ++v) {
+            double sum = 0;
+            for (int l = 0; l < L; ++l)
+                sum += acc[r][v][l];
+            for (int jj = j; jj < n; ++jj)
+                sum += a[(size_t)r * lda + jj] * X[(size_t)v * ldx + jj];
+            y[(size_t)v * ldy + r] = sum;
+        }
+}
+
+#else
+
+template <int Bytes, int R, int K>
+GEMM_INLINE void gemvTile(int n, const double* a, int lda, const double* X, int ldx, double* y, int ldy) {
+    double sum[R][K] = {};
+    for (int j = 0; j < n; ++j)
+        for (int r = 0; r < R; ++r)
+            for (int v = 0; v < K; ++v)
+                sum[r][v] += a[(size_t)r * lda + j] * X[(size_t)v * ldx + j];
+    for (int r = 0; r < R; ++r)
+        for (int v = 0; v < K; ++v)
+            y[(size_t)v * ldy + r] = sum[r][v];
+}
+
+#endif
+
+template <int Bytes, int R>
+GEMM_INLINE void gemvTileGroup(int k, int n, const double* a, int lda, const double* X, int ldx, double* y, int ldy) {
+    switch (k) {
+    case 1: gemvTile<Bytes, R, 1>(n, a, lda, X, ldx, y, ldy); break;
+    case 2: gemvTile<Bytes, R, 2>(n, a, lda, X, ldx, y, ldy); break;
+    case 3: gemvTile<Bytes, R, 3>(n, a, lda, X, ldx, y, ldy); break;
+    default: gemvTile<Bytes, R, 4>(n, a, lda, X, ldx, y, ldy); break;
+    }
+}
+
+// Блок из rows <= GEMV_ROWS строк на все k векторов группами по MaxK
+template <int Bytes, int MaxK>
+GEMM_INLINE void gemvBlock(int rows, int n, const double* a, int lda, int k, const double* X, int ldx, double* y,
+    int ldy) {
+    for (int v0 = 0; v0 < k; v0 += MaxK) {
+        const int kk = std::min(MaxK, k - v0);
+        const double* x = X + (size_t)v0 * ldx;
+        double* yv = y + (size_t)v0 * ldy;
+        switch (rows) {
+        case 1: gemvTileGroup<Bytes, 1>(kk, n, a, lda, x, ldx, yv, ldy); break;
+        case 2: gemvTileGroup<Bytes, 2>(kk, n, a, lda, x, ldx, yv, ldy); break;
+        case 3: gemvTileGroup<Bytes, 3>(kk, n, a, lda, x, ldx, yv, ldy); break;
+        default: gemvTileGroup<Bytes, GEMV_ROWS>(kk, n, a, lda, x, ldx, yv, ldy); break;
+        }
+    }
+}
+
+typedef void (*GemvBlockFn)(int, int, const double*, int, int, const double*, int, double*, int);
+
+// Векторов на плитку: 16 регистров SSE и AVX2 вмещают 4 x 2 аккумулятора, 32 регистра AVX-512 - 4 x 4
+inline void gemvBlockGeneric(int rows, int n, const double* a, int lda, int k, const double* X, int ldx, double* y,
+    int ldy) {
+    gemvBlock<16, 2>(rows, n, a, lda, k, X, ldx, y, ldy);
+}
+
+#ifdef GEMM_X86
+__attribute__((target("avx2,fma"))) inline void gemvBlockAvx2(int rows, int n, const double* a, int lda, int k,
+    const double* X, int ldx, double* y, int ldy) {
+    gemvBlock<32, 2>(rows, n, a, lda, k, X, ldx, y, ldy);
+}
+
+__attribute__((target("avx512f"))) inline void gemvBlockAvx512(int rows, int n, const double* a, int lda, int k,
+    const double* X, int ldx, double* y, int ldy) {
+    gemvBlock<64, 4>(rows, n, a, lda, k, X, ldx, y, ldy);
+}
+#endif
+
+inline GemvBlockFn selectGemvBlock(GemmIsa isa) {
+#ifdef GEMM_X86
+    if (isa == GemmIsa::AVX512)
+        return gemvBlockAvx512;
+    if (isa == GemmIsa::AVX2)
+        return gemvBlockAvx2;
+#endif
+    (void)isa;
+    return gemvBlockGeneric;
+}
+
+// Y (k x m): строка v - A (m x n) на строку v матрицы X (k x n)
+inline void gemvBatch(int m, int n, const double* A, int lda, int k, const double* X, int ldx, double* Y, int ldy) {
+    const GemvBlockFn block = selectGemvBlock(gemmIsa());
+    const int blocks = (m + GEMV_ROWS - 1) / GEMV_ROWS;
+
+#pragma omp parallel for schedule(static)
+    for (int b = 0; b < blocks; ++b) {
+        const int i = b * GEMV_ROWS;
+        block(std::min(GEMV_ROWS, m - i), n, A + (size_t)i * lda, lda, k, X, ldx, Y + i, ldy);
+    }
+}
+
+inline void gemvBatch(const Matrix<double>& A, const Matrix<double>& X, Matrix<double>& Y) {
+    Y.resize(X.rows(), A.rows());
+    gemvBatch(A.rows(), A.cols(), A.data(), A.ld(), X.rows(), X.data(), X.ld(), Y.data(), Y.ld());
+}
+
+// y = A x для одного вектора
+inline void gemv(const Matrix<double>& A, const double* x, double* y) {
+    gemvBatch(A.rows(), A.cols(), A.data(), A.ld(), 1, x, A.cols(), y, A.rows());
+}
+
+// Пропускная способность памяти по STREAM Triad (a = b + s * c), ГБ/с: лучший из пяти
+// проходов, считаются 24 байта на элемент, как в STREAM. Массивы первым касанием
+// распределяются между потоками так же, как в самом тесте
+inline double streamTriadBandwidth(size_t n) {
+    AlignedArray<double> a(n), b(n), c(n);
+    double* pa = a.data();
+    double* pb = b.data();
+    double* pc = c.data();
+    const long long count = (long long)n;
+
+#pragma omp parallel for schedule(static)
+    for (long long i = 0; i < count; ++i) {
+        pa[i] = 0;
+        pb[i] = 1;
+        pc[i] = 2;
+    }
+
+    double best = 1e30;
+    for (int run = 0; run < 5; ++run) {
+        double start = omp_get_wtime();
+#pragma omp parallel for schedule(static)
+        for (long long i = 0; i < count; ++i)
+            pa[i] = pb[i] + 3.0 * pc[i];
+        best = std::min(best, omp_get_wtime() - start);
+    }
+    return 24.0 * n / best / 1e9;
+}
@@ -1,19 +1,26 @@
 ﻿#include <iostream>
 #include <vector>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <cmath>
 #include <chrono>
 #include <omp.h>
+#include "Gemv.h"
 
 using namespace std;
 using namespace chrono;
 
-// Генерация случайной матрицы размером n x n и вектора размером n
-void generateRandomData(int n, vector<vector<double>>& matrix, vector<double>& vec) {
+// Элементов в каждом массиве STREAM Triad: 256 МБ на массив, заметно больше кэшей
+const size_t STREAM_SIZE = 32 * 1024 * 1024;
+
+// Генерация случайной матрицы размером n x n и вектора размером n. Память матрицы уже
+// обнулена параллельно в конструкторе, поэтому страницы распределены между потоками
+void generateRandomData(int n, Matrix<double>& matrix, vector<double>& vec) {
     srand(time(nullptr));
 
     // Генерация случайной матрицы в диапазоне от -100 до 100
-    matrix.resize(n, vector<double>(n));
+    matrix = Matrix<double>(n, n);
     for (int i = 0; i < n; ++i)
         for (int j = 0; j < n; ++j)
             matrix[i][j] = rand() % 201 - 100;
@@ -25,8 +32,8 @@ void generateRandomData(int n, vector<vector<double>>& matrix, vector<double>& v
 }
 
 // Последовательное умножение матрицы на вектор
-void matrixVectorMultSeq(const vector<vector<double>>& matrix, const vector<double>& vec, vector<double>& result) {
-    int n = matrix.size();
+void matrixVectorMultSeq(const Matrix<double>& matrix, const vector<double>& vec, vector<double>& result) {
+    int n = matrix.rows();
     for (int i = 0; i < n; ++i) {
         result[i] = 0.0;
         for (int j = 0; j < n; ++j) {
@@ -35,35 +42,52 @@ void matrixVectorMultSeq(const vector<vector<double>>& matrix, const vector<doub
     }
 }
 
-// Параллельное умножение матрицы на вектор
-void matrixVectorMultPar(const vector<vector<double>>& matrix, const vector<double>& vec, vector<double>& result) {
-    int n = matrix.size();
-
-    // Параллельный цикл с динамическим распределением задач по потокам
-    #pragma omp parallel for schedule(dynamic, 1000) // Используем динамическое распределение
-        for (int i = 0; i < n; ++i) {
-            double local_sum = 0.0; // Локальная сумма для каждой строки
-            for (int j = 0; j < n; ++j) {
-                local_sum += matrix[i][j] * vec[j];
-            }
-
-        // Используем атомарную операцию для добавления локальной суммы к результату
-        #pragma omp atomic
-        result[i] += local_sum;
+// Параллельное умножение матрицы на вектор: каждая строка целиком у одного потока,
+// результат пишется без атомарных операций
+void matrixVectorMultPar(const Matrix<double>& matrix, const vector<double>& vec, vector<double>& result) {
+    gemv(matrix, vec.data(), result.data());
+}
+
+// Пакет из k векторов: время лучшего из трёх запусков и достигнутая пропускная способность
+void benchmarkBatch(const Matrix<double>& matrix, int k, double stream_gbs) {
+    const int n = matrix.rows();
+    Matrix<double> X(k, n), Y(k, n);
+    for (int v = 0; v < k; ++v)
+        for (int j = 0; j < n; ++j)
+            X[v][j] = rand() % 201 - 100;
+
+    double best = 1e30;
+    for (int run = 0; run < 3; ++run) {
+        auto start = high_resolution_clock::now();
+        gemvBatch(matrix, X, Y);
+        best = min(best, duration<double>(high_resolution_clock::now() - start).count());
+    }
+
+    // Проверка на нескольких строках
+    double max_error = 0;
+    for (int i = 0; i < n; i += n / 7 + 1)
+        for (int v = 0; v < k; ++v) {
+            double sum = 0;
+            for (int j = 0; j < n; ++j)
+                sum += matrix[i][j] * X[v][j];
+            max_error = max(max_error, fabs(sum - Y[v][i]) / max(fabs(sum), 1.0));
         }
+
+    // Матрица читается один раз, векторы x читаются и векторы y пишутся по разу
+    const double bytes = 8.0 * ((double)n * n + 2.0 * k * n);
+    const double gbs = bytes / best / 1e9;
+    printf("%5d %10.2f %12.3f %9.1f %8.1f%% %9.2f   %.1e\n", k, best * 1000, best * 1000 / k, gbs,
+        100 * gbs / stream_gbs, 2.0 * n * n * k / best / 1e9, max_error);
 }
 
-int main() {
-    int n = 10000; // Увеличиваем размер матрицы для более точной оценки
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 10000; // Увеличиваем размер матрицы для более точной оценки
 
     // Генерация случайных данных
-    vector<vector<double>> matrix;
+    Matrix<double> matrix;
     vector<double> vec, result_seq(n, 0.0), result_par(n, 0.0);
     generateRandomData(n, matrix, vec);
 
-    // Установка количества потоков
-    omp_set_num_threads(8);
-
     // Замер времени для последовательного умножения
     auto start_seq = high_resolution_clock::now();
     matrixVectorMultSeq(matrix, vec, result_seq);
@@ -93,7 +117,7 @@ int main() {
     cout << "Time difference: " << abs(time_seq - time_par) << " ms" << endl;
 
     // Ускорение
-    double speedup = (double)time_seq / time_par;
+    double speedup = (double)time_seq / max<long long>(time_par, 1);
     cout << "Speedup: " << speedup << "x" << endl;
 
     // Проверка корректности
@@ -104,5 +128,12 @@ int main() {
         cout << "Results are incorrect!" << endl;
     }
 
+    // Пакеты векторов: строка матрицы читается из памяти один раз на весь пакет
+    double stream_gbs = streamTriadBandwidth(STREAM_SIZE);
+    printf("\nThreads: %d, STREAM Triad: %.1f GB/s\n", omp_get_max_threads(), stream_gbs);
+    printf("    k   time ms  ms/vector      GB/s   STREAM   GFLOP/s   error\n");
+    for (int k : { 1, 2, 4, 8, 16 })
+        benchmarkBatch(matrix, k, stream_gbs);
+
     return 0;
 }
@@ -0,0 +1,146 @@
+﻿#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+#include <omp.h>
+#include "Solvers.h"
+
+using namespace std;
+
+// Сопряжённые градиенты и степенной метод на плотной матрице (ядро gemv) и на разреженных
+// матрицах в CSR и SELL-C-σ, со слитыми векторными операциями и без них. Для каждого
+// запуска - число итераций, время и трафик памяти на итерацию, для CG - проверка невязки
+// заново вычисленным b - A x.
+//   Solvers [sparse_rows] [dense_size]
+
+const int DEFAULT_ROWS = 1000000;
+const int DEFAULT_DENSE_SIZE = 4000;
+const int BAND_HALF_WIDTH = 8;
+const int POWER_LAW_DEGREE = 16;
+const double POWER_LAW_EXPONENT = 2.1;
+
+// Критерии остановки: CG до относительной невязки 1e-8, степенной метод - до 1e-6 от |λ|.
+// Число итераций ограничено: на степенной матрице без предобуславливания CG сходится за
+// тысячи итераций, а на ленточной близкие собственные значения тормозят степенной метод
+const double CG_TOLERANCE = 1e-8;
+const int CG_MAX_ITERATIONS = 500;
+const double POWER_TOLERANCE = 1e-6;
+const int POWER_MAX_ITERATIONS = 200;
+
+// Элементов в каждом массиве STREAM Triad
+const size_t STREAM_SIZE = 32 * 1024 * 1024;
+
+// Плотная симметричная матрица 1 + w_ij (|w_ij| <= 0.5) с n на диагонали: положительно
+// определена, собственный вектор, близкий к единичному, отделён от остальных
+Matrix<double> dense_spd_matrix(int n) {
+    Matrix<double> A(n, n);
+    mt19937 gen(3);
+    uniform_real_distribution<double> dist(-0.5, 0.5);
+    for (int i = 0; i < n; ++i) {
+        A[i][i] = n;
+        for (int j = i + 1; j < n; ++j)
+            A[i][j] = A[j][i] = 1 + dist(gen);
+    }
+    return A;
+}
+
+void print_header() {
+    printf("  %-22s %6s %5s %10s %10s %9s %9s %8s %8s\n", "solver", "iters", "conv", "residual", "time ms", "ms/iter",
+        "MB/iter", "GB/s", "STREAM");
+}
+
+void print_result(const char* name, const SolverResult& r, double stream_gbs) {
+    const double per_iteration = r.seconds / max(r.iterations, 1);
+    const double gbs = r.bytes_per_iteration / per_iteration / 1e9;
+    printf("  %-22s %6d %5s %10.2e %10.2f %9.3f %9.1f %8.1f %7.1f%%\n", name, r.iterations, r.converged ? "yes" : "no",
+        r.residual, r.seconds * 1000, per_iteration * 1000, r.bytes_per_iteration / 1e6, gbs, 100 * gbs / stream_gbs);
+}
+
+// Невязка ||b - A x|| / ||b||, посчитанная заново
+template <typename Operator>
+double true_residual(const Operator& A, const vector<double>& b, const vector<double>& x) {
+    vector<double> ax(b.size());
+    A.apply(x.data(), ax.data());
+    double rr = 0, bb = 0;
+    for (size_t i = 0; i < b.size(); ++i) {
+        rr += (b[i] - ax[i]) * (b[i] - ax[i]);
+        bb += b[i] * b[i];
+    }
+    return sqrt(rr / bb);
+}
+
+template <typename Operator>
+void run_solvers(const string& name, const Operator& A, double stream_gbs) {
+    const int n = A.size();
+    printf("\n%s: n = %d, %.1f MB per product\n", name.c_str(), n, A.bytes() / 1e6);
+    print_header();
+
+    mt19937 gen(11);
+    uniform_real_distribution<double> dist(-1, 1);
+    vector<double> b(n), start(n);
+    for (int i = 0; i < n; ++i) {
+        b[i] = dist(gen);
+        start[i] = 1 + 0.1 * dist(gen);
+    }
+
+    // Прогрев: матрица и векторы уже в памяти, первый запуск не платит за страницы
+    vector<double> warm(n);
+    A.apply(b.data(), warm.data());
+
+    SolverOptions cg_options;
+    cg_options.tolerance = CG_TOLERANCE;
+    cg_options.max_iterations = CG_MAX_ITERATIONS;
+    SolverOptions power_options;
+    power_options.tolerance = POWER_TOLERANCE;
+    power_options.max_iterations = POWER_MAX_ITERATIONS;
+
+    vector<double> x_fused(n, 0.0), x_unfused(n, 0.0);
+    SolverResult fused = conjugateGradient(A, b.data(), x_fused.data(), cg_options);
+    print_result("CG, fused", fused, stream_gbs);
+    SolverResult unfused = conjugateGradientUnfused(A, b.data(), x_unfused.data(), cg_options);
+    print_result("CG, separate passes", unfused, stream_gbs);
+    printf("  CG true residual: %.2e (fused), %.2e (separate)\n", true_residual(A, b, x_fused),
+        true_residual(A, b, x_unfused));
+
+    vector<double> v_fused = start, v_unfused = start;
+    SolverResult power_fused = powerIteration(A, v_fused.data(), power_options);
+    print_result("Power, fused", power_fused, stream_gbs);
+    SolverResult power_unfused = powerIterationUnfused(A, v_unfused.data(), power_options);
+    print_result("Power, separate passes", power_unfused, stream_gbs);
+    printf("  Largest eigenvalue: %.10g (fused), %.10g (separate)\n", power_fused.eigenvalue, power_unfused.eigenvalue);
+
+    printf("  Speedup per iteration: CG %.2fx, power %.2fx\n",
+        (unfused.seconds / max(unfused.iterations, 1)) / (fused.seconds / max(fused.iterations, 1)),
+        (power_unfused.seconds / max(power_unfused.iterations, 1)) /
+            (power_fused.seconds / max(power_fused.iterations, 1)));
+}
+
+int main(int argc, char* argv[]) {
+    int rows = argc > 1 ? atoi(argv[1]) : DEFAULT_ROWS;
+    int dense_size = argc > 2 ? atoi(argv[2]) : DEFAULT_DENSE_SIZE;
+
+    double stream_gbs = streamTriadBandwidth(STREAM_SIZE);
+    printf("Threads: %d, STREAM Triad: %.1f GB/s\n", omp_get_max_threads(), stream_gbs);
+
+    {
+        Matrix<double> dense = dense_spd_matrix(dense_size);
+        run_solvers("Dense", DenseOperator{ dense }, stream_gbs);
+    }
+    {
+        CsrMatrix banded = bandedMatrix(rows, BAND_HALF_WIDTH);
+        SellMatrix banded_sell = sellFromCsr(banded);
+        run_solvers("Banded, CSR", CsrOperator{ banded }, stream_gbs);
+        run_solvers("Banded, SELL", SellOperator{ banded_sell }, stream_gbs);
+    }
+    {
+        CsrMatrix power_law = powerLawMatrix(rows, POWER_LAW_DEGREE, POWER_LAW_EXPONENT, 1);
+        SellMatrix power_law_sell = sellFromCsr(power_law);
+        run_solvers("Power-law, CSR", CsrOperator{ power_law }, stream_gbs);
+        run_solvers("Power-law, SELL", SellOperator{ power_law_sell }, stream_gbs);
+    }
+
+    return 0;
+}
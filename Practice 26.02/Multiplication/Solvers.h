@@ -0,0 +1,365 @@
+﻿#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include "Gemv.h"
+#include "Sparse.h"
+
+// Итерационные методы на умножении матрицы на вектор: сопряжённые градиенты для
+// симметричных положительно определённых систем и степенной метод для наибольшего по
+// модулю собственного значения. Матрица задаётся оператором с методами size(), apply(x, y)
+// и bytes(); apply считает y = A x и в том же проходе - скалярные произведения x·y и y·y,
+// пока строки y ещё в кэше. Векторные операции слиты в общие параллельные проходы, чтобы
+// каждый вектор читался за итерацию как можно меньше раз; для сравнения есть варианты
+// с отдельными проходами на каждую операцию, как при вызовах BLAS 1.
+// Все проходы по векторам - schedule(static), как первое касание при их обнулении.
+
+struct SolverOptions {
+    double tolerance = 1e-8;           // относительная: ||r|| <= tolerance * ||b||, или невязка собственной пары
+    double absolute_tolerance = 0;     // абсолютная, срабатывает любая из двух
+    int max_iterations = 1000;
+};
+
+struct SolverResult {
+    int iterations = 0;
+    bool converged = false;
+    double residual = 0;               // итоговая невязка (норма)
+    double eigenvalue = 0;             // для степенного метода
+    double seconds = 0;
+    double bytes_per_iteration = 0;    // модель трафика памяти: матрица и векторы, каждый поток - один раз
+};
+
+// Скалярные произведения, посчитанные вместе с y = A x
+struct MatVecDots {
+    double xy = 0, yy = 0;
+};
+
+// Плотная матрица: блоки строк ядра gemv, скалярные произведения - по только что записанным строкам
+struct DenseOperator {
+    const Matrix<double>& A;
+
+    int size() const { return A.rows(); }
+
+    MatVecDots apply(const double* x, double* y) const {
+        const GemvBlockFn block = selectGemvBlock(gemmIsa());
+        const int m = A.rows(), n = A.cols(), blocks = (m + GEMV_ROWS - 1) / GEMV_ROWS;
+        double xy = 0, yy = 0;
+
+#pragma omp parallel for schedule(static) reduction(+ : xy, yy)
+        for (int b = 0; b < blocks; ++b) {
+            const int i = b * GEMV_ROWS, rows = std::min(GEMV_ROWS, m - i);
+            block(rows, n, A[i], A.ld(), 1, x, n, y + i, m);
+            for (int r = i; r < i + rows; ++r) {
+                xy += x[r] * y[r];
+                yy += y[r] * y[r];
+            }
+        }
+        return { xy, yy };
+    }
+
+    double bytes() const { return 8.0 * A.rows() * A.cols() + 16.0 * A.rows(); }
+};
+
+// CSR: участки строк с равной долей ненулевых элементов, как в spmvCsr
+struct CsrOperator {
+    const CsrMatrix& A;
+
+    int size() const { return A.rows; }
+
+    MatVecDots apply(const double* x, double* y) const {
+        double xy = 0, yy = 0;
+#pragma omp parallel reduction(+ : xy, yy)
+        {
+            const int p = omp_get_num_threads(), t = omp_get_thread_num();
+            const int r0 = balancedBoundary(A.row_ptr, A.rows, t, p), r1 = balancedBoundary(A.row_ptr, A.rows, t + 1, p);
+            const size_t* ptr = A.row_ptr.data();
+            const int* col = A.col_idx.data();
+            const double* val = A.values.data();
+            for (int r = r0; r < r1; ++r) {
+                double sum = 0;
+                for (size_t q = ptr[r]; q < ptr[r + 1]; ++q)
+                    sum += val[q] * x[col[q]];
+                y[r] = sum;
+                xy += x[r] * sum;
+                yy += sum * sum;
+            }
+        }
+        return { xy, yy };
+    }
+
+    double bytes() const { return 12.0 * A.nnz() + 8.0 * (A.rows + 1) + 16.0 * A.rows; }
+};
+
+// SELL-C-σ: ломти делятся по числу хранимых элементов, как в spmvSell
+struct SellOperator {
+    const SellMatrix& S;
+
+    int size() const { return S.rows; }
+
+    MatVecDots apply(const double* x, double* y) const {
+        switch (S.C) {
+        case 4: return applyChunks<4>(x, y);
+        case 16: return applyChunks<16>(x, y);
+        default: return applyChunks<8>(x, y);
+        }
+    }
+
+    template <int C>
+    MatVecDots applyChunks(const double* x, double* y) const {
+        double xy = 0, yy = 0;
+#pragma omp parallel reduction(+ : xy, yy)
+        {
+            const int p = omp_get_num_threads(), t = omp_get_thread_num();
+            const int chunks = S.chunks();
+            const int c0 = balancedBoundary(S.chunk_ptr, chunks, t, p), c1 = balancedBoundary(S.chunk_ptr, chunks, t + 1, p);
+            const int* col = S.col_idx.data();
+            const double* val = S.values.data();
+            for (int c = c0; c < c1; ++c) {
+                double acc[C] = {};
+                const size_t base = S.chunk_ptr[c], width = (S.chunk_ptr[c + 1] - base) / C;
+                for (size_t j = 0; j < width; ++j) {
+                    const double* v = val + base + j * C;
+                    const int* ci = col + base + j * C;
+#pragma omp simd
+                    for (int r = 0; r < C; ++r)
+                        acc[r] += v[r] * x[ci[r]];
+                }
+                for (int r = 0; r < C && c * C + r < S.rows; ++r) {
+                    const int row = S.row_order[c * C + r];
+                    y[row] = acc[r];
+                    xy += x[row] * acc[r];
+                    yy += acc[r] * acc[r];
+                }
+            }
+        }
+        return { xy, yy };
+    }
+
+    double bytes() const { return 12.0 * S.stored() + 8.0 * (S.chunks() + 1) + 4.0 * S.rows + 16.0 * S.rows; }
+};
+
+// Вектор с первым касанием по schedule(static)
+inline AlignedArray<double> solverVector(int n, double value = 0) {
+    AlignedArray<double> v((size_t)n);
+    double* p = v.data();
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i)
+        p[i] = value;
+    return v;
+}
+
+// Отдельные проходы BLAS 1 для вариантов без слияния
+inline double vectorDot(int n, const double* x, const double* y) {
+    double sum = 0;
+#pragma omp parallel for schedule(static) reduction(+ : sum)
+    for (int i = 0; i < n; ++i)
+        sum += x[i] * y[i];
+    return sum;
+}
+
+// y += alpha x
+inline void vectorAxpy(int n, double alpha, const double* x, double* y) {
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i)
+        y[i] += alpha * x[i];
+}
+
+// y = x + beta y
+inline void vectorXpay(int n, const double* x, double beta, double* y) {
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i)
+        y[i] = x[i] + beta * y[i];
+}
+
+inline void vectorScale(int n, double alpha, const double* x, double* y) {
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i)
+        y[i] = alpha * x[i];
+}
+
+// Начальная невязка r = b - A x, p = r; заодно ||b||^2 и ||r||^2
+template <typename Operator>
+inline void cgStart(const Operator& A, const double* b, const double* x, double* r, double* p, double* q,
+    double& bb, double& rr) {
+    const int n = A.size();
+    A.apply(x, q);
+    bb = 0;
+    rr = 0;
+#pragma omp parallel for schedule(static) reduction(+ : bb, rr)
+    for (int i = 0; i < n; ++i) {
+        const double ri = b[i] - q[i];
+        r[i] = ri;
+        p[i] = ri;
+        bb += b[i] * b[i];
+        rr += ri * ri;
+    }
+}
+
+inline bool solverConverged(double residual, double reference, const SolverOptions& options) {
+    return residual <= std::max(options.tolerance * reference, options.absolute_tolerance);
+}
+
+// Сопряжённые градиенты, x - начальное приближение и результат. За итерацию три прохода:
+// q = A p вместе с p·q; x += alpha p, r -= alpha q вместе с r·r; p = r + beta p.
+// Векторов читается и пишется 9 (плюс p и q в самом умножении) вместо 12 у отдельных операций
+template <typename Operator>
+SolverResult conjugateGradient(const Operator& A, const double* b, double* x, const SolverOptions& options = {}) {
+    const int n = A.size();
+    AlignedArray<double> r = solverVector(n), p = solverVector(n), q = solverVector(n);
+    double* pr = r.data();
+    double* pp = p.data();
+    double* pq = q.data();
+
+    SolverResult result;
+    double start = omp_get_wtime();
+    double bb, rr;
+    cgStart(A, b, x, pr, pp, pq, bb, rr);
+    const double b_norm = std::sqrt(bb);
+
+    while (!(result.converged = solverConverged(std::sqrt(rr), b_norm, options)) &&
+           result.iterations < options.max_iterations) {
+        const double alpha = rr / A.apply(pp, pq).xy;
+
+        double rr_next = 0;
+#pragma omp parallel for schedule(static) reduction(+ : rr_next)
+        for (int i = 0; i < n; ++i) {
+            x[i] += alpha * pp[i];
+            const double ri = pr[i] - alpha * pq[i];
+            pr[i] = ri;
+            rr_next += ri * ri;
+        }
+
+        const double beta = rr_next / rr;
+        rr = rr_next;
+        vectorXpay(n, pr, beta, pp);
+        ++result.iterations;
+    }
+
+    result.seconds = omp_get_wtime() - start;
+    result.residual = std::sqrt(rr);
+    result.bytes_per_iteration = A.bytes() + 9.0 * 8 * n;
+    return result;
+}
+
+// Те же сопряжённые градиенты из отдельных операций: два скалярных произведения, два axpy и xpay
+template <typename Operator>
+SolverResult conjugateGradientUnfused(const Operator& A, const double* b, double* x, const SolverOptions& options = {}) {
+    const int n = A.size();
+    AlignedArray<double> r = solverVector(n), p = solverVector(n), q = solverVector(n);
+    double* pr = r.data();
+    double* pp = p.data();
+    double* pq = q.data();
+
+    SolverResult result;
+    double start = omp_get_wtime();
+    double bb, rr;
+    cgStart(A, b, x, pr, pp, pq, bb, rr);
+    const double b_norm = std::sqrt(bb);
+
+    while (!(result.converged = solverConverged(std::sqrt(rr), b_norm, options)) &&
+           result.iterations < options.max_iterations) {
+        A.apply(pp, pq);
+        const double alpha = rr / vectorDot(n, pp, pq);
+        vectorAxpy(n, alpha, pp, x);
+        vectorAxpy(n, -alpha, pq, pr);
+        const double rr_next = vectorDot(n, pr, pr);
+        vectorXpay(n, pr, rr_next / rr, pp);
+        rr = rr_next;
+        ++result.iterations;
+    }
+
+    result.seconds = omp_get_wtime() - start;
+    result.residual = std::sqrt(rr);
+    result.bytes_per_iteration = A.bytes() + 12.0 * 8 * n;
+    return result;
+}
+
+// Копия вектора, если итерация закончилась во внутреннем буфере
+inline void solverCopy(int n, const double* from, double* to) {
+    if (from == to)
+        return;
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i)
+        to[i] = from[i];
+}
+
+// Степенной метод, x - начальный вектор (ненулевой) и найденный собственный вектор единичной
+// нормы. При ||x|| = 1 умножение сразу даёт λ = x·A x. Невязка ||y - λ x|| считается по
+// элементам в проходе нормировки: формула y·y - λ^2 вычитает близкие величины порядка λ^2
+// и ниже sqrt(eps) |λ| даёт шум. Нормированный y пишется на место y, а x не трогается, так
+// что невязка и λ относятся к тому вектору, который возвращается; следующая итерация
+// меняет буферы местами. Остановка - по невязке относительно |λ|
+template <typename Operator>
+SolverResult powerIteration(const Operator& A, double* x, const SolverOptions& options = {}) {
+    const int n = A.size();
+    AlignedArray<double> y = solverVector(n);
+    double* current = x;
+    double* next = y.data();
+
+    SolverResult result;
+    double start = omp_get_wtime();
+    vectorScale(n, 1 / std::sqrt(vectorDot(n, x, x)), x, x);
+
+    while (result.iterations < options.max_iterations) {
+        const MatVecDots dots = A.apply(current, next);
+        const double lambda = dots.xy, scale = 1 / std::sqrt(dots.yy);
+
+        double rr = 0;
+#pragma omp parallel for schedule(static) reduction(+ : rr)
+        for (int i = 0; i < n; ++i) {
+            const double d = next[i] - lambda * current[i];
+            rr += d * d;
+            next[i] *= scale;
+        }
+
+        result.eigenvalue = lambda;
+        result.residual = std::sqrt(rr);
+        ++result.iterations;
+        result.converged = solverConverged(result.residual, std::fabs(lambda), options);
+        if (result.converged || result.iterations == options.max_iterations)
+            break;
+        std::swap(current, next);
+    }
+
+    solverCopy(n, current, x);
+    result.seconds = omp_get_wtime() - start;
+    result.bytes_per_iteration = A.bytes() + 3.0 * 8 * n;
+    return result;
+}
+
+// Степенной метод из отдельных операций: умножение, x·y, невязка копией y и axpy, y·y и нормировка
+template <typename Operator>
+SolverResult powerIterationUnfused(const Operator& A, double* x, const SolverOptions& options = {}) {
+    const int n = A.size();
+    AlignedArray<double> y = solverVector(n), r = solverVector(n);
+    double* current = x;
+    double* next = y.data();
+    double* pr = r.data();
+
+    SolverResult result;
+    double start = omp_get_wtime();
+    vectorScale(n, 1 / std::sqrt(vectorDot(n, x, x)), x, x);
+
+    while (result.iterations < options.max_iterations) {
+        A.apply(current, next);
+        const double lambda = vectorDot(n, current, next);
+        vectorScale(n, 1.0, next, pr);
+        vectorAxpy(n, -lambda, current, pr);
+        result.eigenvalue = lambda;
+        result.residual = std::sqrt(vectorDot(n, pr, pr));
+        vectorScale(n, 1 / std::sqrt(vectorDot(n, next, next)), next, next);
+        ++result.iterations;
+        result.converged = solverConverged(result.residual, std::fabs(lambda), options);
+        if (result.converged || result.iterations == options.max_iterations)
+            break;
+        std::swap(current, next);
+    }
+
+    solverCopy(n, current, x);
+    result.seconds = omp_get_wtime() - start;
+    result.bytes_per_iteration = A.bytes() + 11.0 * 8 * n;
+    return result;
+}
@@ -0,0 +1,191 @@
+﻿#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <omp.h>
+#include "Gemv.h"
+#include "Sparse.h"
+
+using namespace std;
+using namespace chrono;
+
+// Умножение разреженной матрицы на вектор: CSR с делением строк поровну и по числу
+// ненулевых элементов, SELL-C-σ; на ленточной матрице (в исходном порядке, после случайной
+// перестановки и после RCM), на матрице со степенным распределением длин строк и, если
+// указан, на файле Matrix Market. Пропускная способность сравнивается со STREAM Triad.
+//   "Sparse Multiplication" [rows] [matrix.mtx]
+
+const int DEFAULT_ROWS = 1000000;
+// Полуширина ленты и средняя степень вершины степенного графа
+const int BAND_HALF_WIDTH = 8;
+const int POWER_LAW_DEGREE = 16;
+const double POWER_LAW_EXPONENT = 2.1;
+// Параметры SELL-C-σ: строк в ломте и окно сортировки
+const int SELL_C = 8;
+const int SELL_SIGMA = 256;
+// Размер плотной матрицы для сравнения с плотным умножением
+const int DENSE_SIZE = 8000;
+// Элементов в каждом массиве STREAM Triad
+const size_t STREAM_SIZE = 32 * 1024 * 1024;
+
+// Лучшее время из нескольких запусков, секунды
+template <typename F>
+double best_time(F f, int runs = 10) {
+    double best = 1e30;
+    for (int run = 0; run < runs; ++run) {
+        auto start = high_resolution_clock::now();
+        f();
+        best = min(best, duration<double>(high_resolution_clock::now() - start).count());
+    }
+    return best;
+}
+
+// Последовательное умножение - эталон для проверки
+void spmv_reference(const CsrMatrix& A, const vector<double>& x, vector<double>& y) {
+    for (int r = 0; r < A.rows; ++r) {
+        double sum = 0;
+        for (size_t p = A.row_ptr[r]; p < A.row_ptr[r + 1]; ++p)
+            sum += A.values[p] * x[A.col_idx[p]];
+        y[r] = sum;
+    }
+}
+
+double max_relative_error(const vector<double>& expected, const vector<double>& actual) {
+    double error = 0;
+    for (size_t i = 0; i < expected.size(); ++i)
+        error = max(error, fabs(expected[i] - actual[i]) / max(fabs(expected[i]), 1.0));
+    return error;
+}
+
+// Байты за одно умножение: значения и индексы столбцов, указатели строк, x и y по разу.
+// Повторные чтения x из памяти не учитываются, поэтому при плохой локальности
+// ГБ/с получаются заниженными
+double csr_bytes(const CsrMatrix& A) {
+    return 12.0 * A.nnz() + 8.0 * (A.rows + 1) + 8.0 * A.cols + 8.0 * A.rows;
+}
+
+double sell_bytes(const SellMatrix& S) {
+    return 12.0 * S.stored() + 8.0 * (S.chunks() + 1) + 4.0 * S.rows + 8.0 * S.cols + 8.0 * S.rows;
+}
+
+void print_kernel(const char* name, double seconds, double nnz, double bytes, double stream_gbs, double error) {
+    double gbs = bytes / seconds / 1e9;
+    printf("  %-22s %9.3f %9.2f %9.1f %8.1f%%   %.1e\n", name, seconds * 1000, 2.0 * nnz / seconds / 1e9, gbs,
+        100 * gbs / stream_gbs, error);
+}
+
+// Ширина ленты несимметричной по размеру матрицы не определена
+int matrix_bandwidth_or_zero(const CsrMatrix& A) {
+    return A.rows == A.cols ? matrixBandwidth(A) : 0;
+}
+
+void benchmark_matrix(const string& name, const CsrMatrix& A, double stream_gbs) {
+    size_t max_row = 0;
+    for (int r = 0; r < A.rows; ++r)
+        max_row = max(max_row, A.row_ptr[r + 1] - A.row_ptr[r]);
+    printf("\n%s: %d x %d, nnz %zu (%.1f per row, longest %zu), bandwidth %d\n", name.c_str(), A.rows, A.cols,
+        A.nnz(), (double)A.nnz() / A.rows, max_row, matrix_bandwidth_or_zero(A));
+
+    mt19937 gen(7);
+    uniform_real_distribution<double> dist(-1, 1);
+    vector<double> x(A.cols), expected(A.rows), y(A.rows);
+    for (double& v : x)
+        v = dist(gen);
+    spmv_reference(A, x, expected);
+
+    SellMatrix S = sellFromCsr(A, SELL_C, SELL_SIGMA);
+
+    printf("  kernel                   time ms   GFLOP/s      GB/s   STREAM   error\n");
+    double t = best_time([&] { spmvCsrStatic(A, x.data(), y.data()); });
+    print_kernel("CSR, rows static", t, A.nnz(), csr_bytes(A), stream_gbs, max_relative_error(expected, y));
+
+    fill(y.begin(), y.end(), 0.0);
+    t = best_time([&] { spmvCsr(A, x.data(), y.data()); });
+    print_kernel("CSR, nnz-balanced", t, A.nnz(), csr_bytes(A), stream_gbs, max_relative_error(expected, y));
+
+    fill(y.begin(), y.end(), 0.0);
+    t = best_time([&] { spmvSell(S, x.data(), y.data()); });
+    char label[64];
+    snprintf(label, sizeof(label), "SELL-%d-%d", S.C, S.sigma);
+    print_kernel(label, t, A.nnz(), sell_bytes(S), stream_gbs, max_relative_error(expected, y));
+    printf("  SELL padding: %.1f%% extra stored elements\n", 100.0 * (S.stored() - S.nnz) / max<size_t>(S.nnz, 1));
+}
+
+// Случайная симметричная перестановка: ленточная структура теряется, как у матрицы
+// с неудачной нумерацией узлов
+CsrMatrix shuffled(const CsrMatrix& A, unsigned seed) {
+    vector<int> perm(A.rows);
+    for (int i = 0; i < A.rows; ++i)
+        perm[i] = i;
+    shuffle(perm.begin(), perm.end(), mt19937(seed));
+    return permuteSymmetric(A, perm);
+}
+
+CsrMatrix rcm_reordered(const CsrMatrix& A) {
+    auto start = high_resolution_clock::now();
+    vector<int> perm = rcmOrdering(A);
+    CsrMatrix B = permuteSymmetric(A, perm);
+    printf("\nRCM reordering time: %lld ms, bandwidth %d -> %d\n",
+        (long long)duration_cast<milliseconds>(high_resolution_clock::now() - start).count(), matrixBandwidth(A),
+        matrixBandwidth(B));
+    return B;
+}
+
+// Та же ленточная матрица в плотном виде: плотное умножение читает все n^2 элементов
+void compare_with_dense() {
+    CsrMatrix A = bandedMatrix(DENSE_SIZE, BAND_HALF_WIDTH);
+    Matrix<double> dense(DENSE_SIZE, DENSE_SIZE);
+    for (int r = 0; r < A.rows; ++r)
+        for (size_t p = A.row_ptr[r]; p < A.row_ptr[r + 1]; ++p)
+            dense[r][A.col_idx[p]] = A.values[p];
+
+    vector<double> x(DENSE_SIZE, 1.0), y_dense(DENSE_SIZE), y_sparse(DENSE_SIZE);
+    double dense_time = best_time([&] { gemv(dense, x.data(), y_dense.data()); });
+    double sparse_time = best_time([&] { spmvCsr(A, x.data(), y_sparse.data()); });
+
+    printf("\nDense vs sparse, banded %d x %d:\n", DENSE_SIZE, DENSE_SIZE);
+    printf("Dense time: %.3f ms (%.1f GB/s)\n", dense_time * 1000, 8.0 * DENSE_SIZE * DENSE_SIZE / dense_time / 1e9);
+    printf("Sparse time: %.3f ms\n", sparse_time * 1000);
+    printf("Speedup: %.1fx\n", dense_time / sparse_time);
+    printf("Results are %s\n", max_relative_error(y_dense, y_sparse) < 1e-12 ? "correct" : "incorrect");
+}
+
+int main(int argc, char* argv[]) {
+    int rows = argc > 1 ? atoi(argv[1]) : DEFAULT_ROWS;
+    string path = argc > 2 ? argv[2] : "";
+
+    double stream_gbs = streamTriadBandwidth(STREAM_SIZE);
+    printf("Threads: %d, STREAM Triad: %.1f GB/s\n", omp_get_max_threads(), stream_gbs);
+
+    compare_with_dense();
+
+    CsrMatrix banded = bandedMatrix(rows, BAND_HALF_WIDTH);
+    benchmark_matrix("Banded", banded, stream_gbs);
+    CsrMatrix banded_shuffled = shuffled(banded, 1);
+    banded = CsrMatrix();
+    benchmark_matrix("Banded, shuffled", banded_shuffled, stream_gbs);
+    benchmark_matrix("Banded, shuffled + RCM", rcm_reordered(banded_shuffled), stream_gbs);
+    banded_shuffled = CsrMatrix();
+
+    CsrMatrix power_law = powerLawMatrix(rows, POWER_LAW_DEGREE, POWER_LAW_EXPONENT, 1);
+    benchmark_matrix("Power-law", power_law, stream_gbs);
+    benchmark_matrix("Power-law + RCM", rcm_reordered(power_law), stream_gbs);
+    power_law = CsrMatrix();
+
+    if (!path.empty()) {
+        CsrMatrix file;
+        if (!readMatrixMarket(path, file)) {
+            printf("\nError: cannot read Matrix Market file %s\n", path.c_str());
+            return 1;
+        }
+        benchmark_matrix(path, file, stream_gbs);
+        if (file.rows == file.cols)
+            benchmark_matrix(path + " + RCM", rcm_reordered(file), stream_gbs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,473 @@
+﻿#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Разреженные матрицы для умножения на вектор.
+// CSR - строки подряд: row_ptr[r]..row_ptr[r + 1] - позиции элементов строки r в col_idx и values.
+// SELL-C-σ - строки сортируются по длине внутри окон из σ строк и группируются в ломти по C
+// строк; ломоть дополняется нулями до самой длинной строки и хранится по столбцам, поэтому
+// C строк обрабатываются одной SIMD-инструкцией (со сбором x по индексам).
+// Умножение делит строки (или ломти) между потоками поровну по числу ненулевых элементов,
+// а не по числу строк - иначе на матрицах со степенным распределением длин строк один
+// поток получает почти всю работу.
+
+struct Triplet {
+    int row, col;
+    double value;
+};
+
+struct CsrMatrix {
+    int rows = 0, cols = 0;
+    std::vector<size_t> row_ptr;
+    std::vector<int> col_idx;
+    std::vector<double> values;
+
+    size_t nnz() const { return values.size(); }
+};
+
+// CSR из троек: столбцы в строке по возрастанию, повторяющиеся элементы складываются
+inline CsrMatrix csrFromTriplets(int rows, int cols, std::vector<Triplet> triplets) {
+    std::sort(triplets.begin(), triplets.end(), [](const Triplet& a, const Triplet& b) {
+        return a.row != b.row ? a.row < b.row : a.col < b.col;
+    });
+
+    CsrMatrix A;
+    A.rows = rows;
+    A.cols = cols;
+    A.row_ptr.assign((size_t)rows + 1, 0);
+    A.col_idx.reserve(triplets.size());
+    A.values.reserve(triplets.size());
+
+    int last_row = -1, last_col = -1;
+    for (const Triplet& t : triplets) {
+        if (t.row == last_row && t.col == last_col) {
+            A.values.back() += t.value;
+            continue;
+        }
+        A.col_idx.push_back(t.col);
+        A.values.push_back(t.value);
+        ++A.row_ptr[t.row + 1];
+        last_row = t.row;
+        last_col = t.col;
+    }
+    for (int r = 0; r < rows; ++r)
+        A.row_ptr[r + 1] += A.row_ptr[r];
+    return A;
+}
+
+// Чтение файла Matrix Market: coordinate, поля real, integer или pattern, симметрия general,
+// symmetric или skew-symmetric. false, если файл не открылся или формат не поддерживается
+inline bool readMatrixMarket(const std::string& path, CsrMatrix& A) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    std::string line, banner, object, format, field, symmetry;
+    std::getline(in, line);
+    std::istringstream header(line);
+    header >> banner >> object >> format >> field >> symmetry;
+    for (std::string* s : { &object, &format, &field, &symmetry })
+        std::transform(s->begin(), s->end(), s->begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    if (banner != "%%MatrixMarket" || object != "matrix" || format != "coordinate" || field == "complex")
+        return false;
+    const bool pattern = field == "pattern";
+    const bool symmetric = symmetry == "symmetric" || symmetry == "hermitian";
+    const bool skew = symmetry == "skew-symmetric";
+
+    while (std::getline(in, line) && (line.empty() || line[0] == '%')) {
+    }
+    long long rows, cols, entries;
+    if (!(std::istringstream(line) >> rows >> cols >> entries))
+        return false;
+
+    std::vector<Triplet> triplets;
+    triplets.reserve((size_t)entries * (symmetric || skew ? 2 : 1));
+    for (long long e = 0; e < entries; ++e) {
+        long long i, j;
+        double value = 1;
+        if (!(in >> i >> j) || (!pattern && !(in >> value)))
+            return false;
+        if (i < 1 || i > rows || j < 1 || j > cols)
+            return false;
+        triplets.push_back({ (int)(i - 1), (int)(j - 1), value });
+        if ((symmetric || skew) && i != j)
+            triplets.push_back({ (int)(j - 1), (int)(i - 1), skew ? -value : value });
+    }
+
+    A = csrFromTriplets((int)rows, (int)cols, std::move(triplets));
+    return true;
+}
+
+// Ленточная симметричная матрица с диагональным преобладанием (положительно определённая):
+// A(i, i) = 2 * half + 1, A(i, j) = -1 при 0 < |i - j| <= half
+inline CsrMatrix bandedMatrix(int n, int half) {
+    CsrMatrix A;
+    A.rows = A.cols = n;
+    A.row_ptr.assign((size_t)n + 1, 0);
+    for (int i = 0; i < n; ++i)
+        A.row_ptr[i + 1] = A.row_ptr[i] + (std::min(n - 1, i + half) - std::max(0, i - half) + 1);
+    A.col_idx.resize(A.row_ptr[n]);
+    A.values.resize(A.row_ptr[n]);
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i) {
+        size_t p = A.row_ptr[i];
+        for (int j = std::max(0, i - half); j <= std::min(n - 1, i + half); ++j, ++p) {
+            A.col_idx[p] = j;
+            A.values[p] = i == j ? 2.0 * half + 1 : -1.0;
+        }
+    }
+    return A;
+}
+
+// Симметричная матрица со степенным распределением длин строк (модель Чунга-Лу): вершина i
+// получает вес (i + 1)^(-1 / (exponent - 1)), концы рёбер выбираются пропорционально весам,
+// поэтому самые длинные строки идут первыми. A(i, j) = -1 для рёбер, на диагонали - число
+// рёбер вершины плюс один, так что матрица положительно определена
+inline CsrMatrix powerLawMatrix(int n, int avg_degree, double exponent, unsigned seed) {
+    std::vector<double> cdf(n);
+    double total = 0;
+    for (int i = 0; i < n; ++i) {
+        total += std::pow(i + 1.0, -1.0 / (exponent - 1));
+        cdf[i] = total;
+    }
+
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> uniform(0, total);
+    auto vertex = [&] { return (int)std::min<size_t>(std::upper_bound(cdf.begin(), cdf.end(), uniform(gen)) - cdf.begin(), n - 1); };
+
+    const long long edges = (long long)n * avg_degree / 2;
+    std::vector<Triplet> triplets;
+    triplets.reserve((size_t)edges * 2 + n);
+    std::vector<int> degree(n, 0);
+    for (long long e = 0; e < edges; ++e) {
+        int i = vertex(), j = vertex();
+        if (i == j)
+            continue;
+        triplets.push_back({ i, j, -1.0 });
+        triplets.push_back({ j, i, -1.0 });
+        ++degree[i];
+        ++degree[j];
+    }
+    for (int i = 0; i < n; ++i)
+        triplets.push_back({ i, i, degree[i] + 1.0 });
+
+    return csrFromTriplets(n, n, std::move(triplets));
+}
+
+// Ширина ленты: наибольшее |i - j| по ненулевым элементам
+inline int matrixBandwidth(const CsrMatrix& A) {
+    int band = 0;
+#pragma omp parallel for schedule(static) reduction(max : band)
+    for (int i = 0; i < A.rows; ++i)
+        for (size_t p = A.row_ptr[i]; p < A.row_ptr[i + 1]; ++p)
+            band = std::max(band, std::abs(i - A.col_idx[p]));
+    return band;
+}
+
+// Симметричная перестановка P A P^T: perm[new] = old, строка и столбец old становятся new
+inline CsrMatrix permuteSymmetric(const CsrMatrix& A, const std::vector<int>& perm) {
+    const int n = A.rows;
+    std::vector<int> inverse(n);
+    for (int i = 0; i < n; ++i)
+        inverse[perm[i]] = i;
+
+    CsrMatrix B;
+    B.rows = B.cols = n;
+    B.row_ptr.assign((size_t)n + 1, 0);
+    for (int i = 0; i < n; ++i)
+        B.row_ptr[i + 1] = B.row_ptr[i] + (A.row_ptr[perm[i] + 1] - A.row_ptr[perm[i]]);
+    B.col_idx.resize(A.nnz());
+    B.values.resize(A.nnz());
+
+#pragma omp parallel
+    {
+        std::vector<std::pair<int, double>> row;
+#pragma omp for schedule(dynamic, 1024)
+        for (int i = 0; i < n; ++i) {
+            const int old = perm[i];
+            row.clear();
+            for (size_t p = A.row_ptr[old]; p < A.row_ptr[old + 1]; ++p)
+                row.push_back({ inverse[A.col_idx[p]], A.values[p] });
+            std::sort(row.begin(), row.end());
+            size_t q = B.row_ptr[i];
+            for (const auto& e : row) {
+                B.col_idx[q] = e.first;
+                B.values[q++] = e.second;
+            }
+        }
+    }
+    return B;
+}
+
+// Вектор в новом порядке: result[new] = x[perm[new]]
+inline std::vector<double> permuteVector(const std::vector<double>& x, const std::vector<int>& perm) {
+    std::vector<double> result(perm.size());
+    for (size_t i = 0; i < perm.size(); ++i)
+        result[i] = x[perm[i]];
+    return result;
+}
+
+// Обратный порядок Катхилла-Макки по структуре A + A^T: обход в ширину, соседи - по
+// возрастанию степени, итог - в обратном порядке. Каждая компонента связности начинается
+// с псевдопериферийной вершины (алгоритм Джорджа-Лю). Возвращает perm[new] = old
+inline std::vector<int> rcmOrdering(const CsrMatrix& A) {
+    const int n = A.rows;
+
+    // Симметричная структура без диагонали
+    std::vector<size_t> adj_ptr((size_t)n + 1, 0);
+    for (int i = 0; i < n; ++i)
+        for (size_t p = A.row_ptr[i]; p < A.row_ptr[i + 1]; ++p)
+            if (A.col_idx[p] != i) {
+                ++adj_ptr[i + 1];
+                ++adj_ptr[A.col_idx[p] + 1];
+            }
+    for (int i = 0; i < n; ++i)
+        adj_ptr[i + 1] += adj_ptr[i];
+    std::vector<int> adj(adj_ptr[n]);
+    std::vector<size_t> fill(adj_ptr.begin(), adj_ptr.end() - 1);
+    for (int i = 0; i < n; ++i)
+        for (size_t p = A.row_ptr[i]; p < A.row_ptr[i + 1]; ++p)
+            if (A.col_idx[p] != i) {
+                adj[fill[i]++] = A.col_idx[p];
+                adj[fill[A.col_idx[p]]++] = i;
+            }
+
+    std::vector<int> degree(n);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int i = 0; i < n; ++i) {
+        auto begin = adj.begin() + adj_ptr[i], end = adj.begin() + adj_ptr[i + 1];
+        std::sort(begin, end);
+        degree[i] = (int)(std::unique(begin, end) - begin);
+    }
+
+    // Обход в ширину от root по ещё не посещённым вершинам; order получает вершины по уровням,
+    // возвращается число уровней, last_level - начало последнего уровня в order
+    std::vector<int> mark(n, -1);
+    int stamp = 0;
+    auto bfs = [&](int root, std::vector<int>& order, size_t& last_level) {
+        ++stamp;
+        const size_t base = order.size();
+        order.push_back(root);
+        mark[root] = stamp;
+        int levels = 0;
+        size_t level_begin = base;
+        while (level_begin < order.size()) {
+            const size_t level_end = order.size();
+            last_level = level_begin;
+            ++levels;
+            for (size_t q = level_begin; q < level_end; ++q) {
+                const int v = order[q];
+                const size_t first = order.size();
+                for (size_t p = adj_ptr[v]; p < adj_ptr[v] + degree[v]; ++p) {
+                    const int u = adj[p];
+                    if (mark[u] != stamp && mark[u] != -2) {
+                        mark[u] = stamp;
+                        order.push_back(u);
+                    }
+                }
+                std::sort(order.begin() + first, order.end(), [&](int a, int b) { return degree[a] < degree[b]; });
+            }
+            level_begin = level_end;
+        }
+        return levels;
+    };
+
+    std::vector<int> by_degree(n);
+    std::iota(by_degree.begin(), by_degree.end(), 0);
+    std::stable_sort(by_degree.begin(), by_degree.end(), [&](int a, int b) { return degree[a] < degree[b]; });
+
+    std::vector<int> perm, probe;
+    perm.reserve(n);
+    for (int start : by_degree) {
+        if (mark[start] == -2)
+            continue;
+
+        // Псевдопериферийная вершина: пока число уровней растёт, переходим в вершину
+        // наименьшей степени на последнем уровне
+        int root = start, levels = 0;
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            probe.clear();
+            size_t last_level = 0;
+            const int current = bfs(root, probe, last_level);
+            if (current <= levels)
+                break;
+            levels = current;
+            root = *std::min_element(probe.begin() + last_level, probe.end(),
+                [&](int a, int b) { return degree[a] < degree[b]; });
+        }
+
+        size_t last_level = 0;
+        const size_t begin = perm.size();
+        bfs(root, perm, last_level);
+        for (size_t q = begin; q < perm.size(); ++q)
+            mark[perm[q]] = -2;
+    }
+
+    std::reverse(perm.begin(), perm.end());
+    return perm;
+}
+
+// Начало части part из parts для префиксных сумм ptr[0..count]: части примерно равны по
+// числу элементов плюс по единице на строку, чтобы длинные участки пустых строк тоже делились
+inline int balancedBoundary(const std::vector<size_t>& ptr, int count, int part, int parts) {
+    const size_t total = ptr[count] + count;
+    const size_t target = (size_t)((double)total * part / parts);
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (ptr[mid] + mid < target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// y = A x: каждый поток берёт непрерывный участок строк с равной долей ненулевых элементов
+inline void spmvCsr(const CsrMatrix& A, const double* x, double* y) {
+#pragma omp parallel
+    {
+        const int p = omp_get_num_threads(), t = omp_get_thread_num();
+        const int r0 = balancedBoundary(A.row_ptr, A.rows, t, p), r1 = balancedBoundary(A.row_ptr, A.rows, t + 1, p);
+        const size_t* ptr = A.row_ptr.data();
+        const int* col = A.col_idx.data();
+        const double* val = A.values.data();
+        for (int r = r0; r < r1; ++r) {
+            double sum = 0;
+            for (size_t q = ptr[r]; q < ptr[r + 1]; ++q)
+                sum += val[q] * x[col[q]];
+            y[r] = sum;
+        }
+    }
+}
+
+// Для сравнения: равное число строк на поток, как schedule(static)
+inline void spmvCsrStatic(const CsrMatrix& A, const double* x, double* y) {
+    const size_t* ptr = A.row_ptr.data();
+    const int* col = A.col_idx.data();
+    const double* val = A.values.data();
+#pragma omp parallel for schedule(static)
+    for (int r = 0; r < A.rows; ++r) {
+        double sum = 0;
+        for (size_t q = ptr[r]; q < ptr[r + 1]; ++q)
+            sum += val[q] * x[col[q]];
+        y[r] = sum;
+    }
+}
+
+struct SellMatrix {
+    int rows = 0, cols = 0;
+    int C = 8, sigma = 1;
+    std::vector<int> row_order;     // строка в порядке SELL -> исходная строка
+    std::vector<size_t> chunk_ptr;  // начало ломтя в values, chunks + 1 значение
+    std::vector<int> col_idx;       // в ломте по столбцам: элемент j строки r - в chunk_ptr + j * C + r
+    std::vector<double> values;
+    size_t nnz = 0;
+
+    int chunks() const { return (int)chunk_ptr.size() - 1; }
+    size_t stored() const { return values.size(); }
+};
+
+// Ядра SELL есть только для C = 4, 8 и 16; другое C округляется вверх до ближайшего из них
+inline int sellSupportedC(int C) {
+    return C <= 4 ? 4 : C <= 8 ? 8 : 16;
+}
+
+// SELL-C-σ из CSR; C - 4, 8 или 16 (строк в ломте, см. sellSupportedC), sigma - окно
+// сортировки строк по длине (не меньше 1). Дополнение ломтя ссылается на столбец 0 с нулевым значением
+inline SellMatrix sellFromCsr(const CsrMatrix& A, int C = 8, int sigma = 256) {
+    C = sellSupportedC(C);
+    sigma = std::max(sigma, 1);
+    SellMatrix S;
+    S.rows = A.rows;
+    S.cols = A.cols;
+    S.C = C;
+    S.sigma = sigma;
+    S.nnz = A.nnz();
+
+    auto length = [&](int r) { return A.row_ptr[r + 1] - A.row_ptr[r]; };
+    S.row_order.resize(A.rows);
+    std::iota(S.row_order.begin(), S.row_order.end(), 0);
+    for (int w = 0; w < A.rows; w += sigma) {
+        auto begin = S.row_order.begin() + w, end = S.row_order.begin() + std::min(A.rows, w + sigma);
+        std::stable_sort(begin, end, [&](int a, int b) { return length(a) > length(b); });
+    }
+
+    const int chunks = (A.rows + C - 1) / C;
+    S.chunk_ptr.assign((size_t)chunks + 1, 0);
+    for (int c = 0; c < chunks; ++c) {
+        size_t width = 0;
+        for (int r = c * C; r < std::min(A.rows, (c + 1) * C); ++r)
+            width = std::max(width, length(S.row_order[r]));
+        S.chunk_ptr[c + 1] = S.chunk_ptr[c] + width * C;
+    }
+    S.col_idx.resize(S.chunk_ptr[chunks]);
+    S.values.resize(S.chunk_ptr[chunks]);
+
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int c = 0; c < chunks; ++c) {
+        const size_t base = S.chunk_ptr[c], width = (S.chunk_ptr[c + 1] - base) / C;
+        for (int r = 0; r < C; ++r) {
+            const int row = c * C + r < A.rows ? S.row_order[c * C + r] : -1;
+            const size_t len = row >= 0 ? length(row) : 0;
+            for (size_t j = 0; j < width; ++j) {
+                const size_t q = base + j * C + r;
+                if (j < len) {
+                    S.col_idx[q] = A.col_idx[A.row_ptr[row] + j];
+                    S.values[q] = A.values[A.row_ptr[row] + j];
+                } else {
+                    S.col_idx[q] = 0;
+                    S.values[q] = 0;
+                }
+            }
+        }
+    }
+    return S;
+}
+
+// Ломти делятся между потоками по числу хранимых элементов; C строк ломтя - в SIMD-цикле
+template <int C>
+inline void spmvSellChunks(const SellMatrix& S, const double* x, double* y) {
+#pragma omp parallel
+    {
+        const int p = omp_get_num_threads(), t = omp_get_thread_num();
+        const int chunks = S.chunks();
+        const int c0 = balancedBoundary(S.chunk_ptr, chunks, t, p), c1 = balancedBoundary(S.chunk_ptr, chunks, t + 1, p);
+        const int* col = S.col_idx.data();
+        const double* val = S.values.data();
+        for (int c = c0; c < c1; ++c) {
+            double acc[C] = {};
+            const size_t base = S.chunk_ptr[c], width = (S.chunk_ptr[c + 1] - base) / C;
+            for (size_t j = 0; j < width; ++j) {
+                const double* v = val + base + j * C;
+                const int* ci = col + base + j * C;
+#pragma omp simd
+                for (int r = 0; r < C; ++r)
+                    acc[r] += v[r] * x[ci[r]];
+            }
+            for (int r = 0; r < C && c * C + r < S.rows; ++r)
+                y[S.row_order[c * C + r]] = acc[r];
+        }
+    }
+}
+
+// y = A x, y - в исходном порядке строк
+inline void spmvSell(const SellMatrix& S, const double* x, double* y) {
+    // sellFromCsr оставляет только C = 4, 8 или 16
+    switch (S.C) {
+    case 4: spmvSellChunks<4>(S, x, y); break;
+    case 16: spmvSellChunks<16>(S, x, y); break;
+    default: spmvSellChunks<8>(S, x, y); break;
+    }
+}
@@ -1,13 +1,25 @@
 ﻿#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <mpi.h>
-#include <windows.h>
 #include <locale>
+#include "../../Practice 19.02/Matrix/Gemm.h"
+
+// Умножение матриц с распределением строк A: строки делятся между процессами через
+// MPI_Scatterv (размер не обязан делиться на число процессов), B рассылается всем.
+// Сначала блокирующий вариант с замером каждой фазы, затем конвейерный: B приходит
+// полосами строк через MPI_Ibcast, и вклад каждой полосы в C считается,
+// пока следующие полосы ещё в пути. Полос не меньше MIN_B_CHUNKS, а полоса не выше блока
+// gemm по k: тогда C обновляется столько же раз, сколько при одном вызове gemm.
+//   mpirun -n P "MPI Matrix" [size]
 
 #define MATRIX_SIZE 500
 #define MIN_RAND_VALUE 1
 #define MAX_RAND_VALUE 10
+// Наибольшая высота полосы B и наименьшее число полос в конвейерной рассылке
+#define B_CHUNK_ROWS 256
+#define MIN_B_CHUNKS 8
 
 // Функция для заполнения матрицы случайными числами
 void fill_matrix(int* matrix, int rows, int cols) {
@@ -28,86 +40,155 @@ void print_matrix_slice(int* matrix, int rows, int cols, int slice_size) {
     }
 }
 
+// Наибольшее значение по всем процессам (на корневом процессе)
+double max_over_processes(double value) {
+    double result;
+    MPI_Reduce(&value, &result, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    return result;
+}
+
 int main(int argc, char* argv[]) {
-    SetConsoleOutputCP(CP_UTF8);
     setlocale(LC_ALL, "C");
 
     int rank, size;
-    double start_time, end_time;
 
     // Инициализация MPI
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank); // Получение номера текущего процесса
     MPI_Comm_size(MPI_COMM_WORLD, &size); // Получение общего числа процессов
 
-    // Проверка, что размер матрицы делится на количество процессов без остатка
-    if (MATRIX_SIZE % size != 0) {
-        if (rank == 0) {
-            printf("Error: matrix size (%d) must be divisible by the number of processes (%d).\n", MATRIX_SIZE, size);
-        }
-        MPI_Finalize();
-        return 1;
-    }
-
-    int rows_per_process = MATRIX_SIZE / size;
+    const int n = argc > 1 ? atoi(argv[1]) : MATRIX_SIZE;
 
-    // Выделение памяти под матрицы
-    int* A = (int*)malloc(MATRIX_SIZE * MATRIX_SIZE * sizeof(int));
-    int* B = (int*)malloc(MATRIX_SIZE * MATRIX_SIZE * sizeof(int));
-    int* C = (int*)malloc(MATRIX_SIZE * MATRIX_SIZE * sizeof(int));
+    // Строки A и C по процессам: первые n % size процессов получают на одну строку больше
+    int* counts = (int*)malloc(size * sizeof(int));
+    int* displs = (int*)malloc(size * sizeof(int));
+    for (int i = 0, offset = 0; i < size; i++) {
+        int rows = n / size + (i < n % size ? 1 : 0);
+        counts[i] = rows * n;
+        displs[i] = offset;
+        offset += counts[i];
+    }
+    int local_rows = counts[rank] / n;
 
-    // Локальные части матрицы A и результирующей матрицы C для каждого процесса
-    int* local_A = (int*)malloc(rows_per_process * MATRIX_SIZE * sizeof(int));
-    int* local_C = (int*)malloc(rows_per_process * MATRIX_SIZE * sizeof(int));
+    // Полные A и C нужны только корневому процессу, B - всем
+    int* A = NULL;
+    int* C = NULL;
+    int* C_pipelined = NULL;
+    int* B = (int*)malloc((size_t)n * n * sizeof(int));
+    int* local_A = (int*)malloc((size_t)local_rows * n * sizeof(int));
+    int* local_C = (int*)malloc((size_t)local_rows * n * sizeof(int));
 
-    // Только корневой процесс (rank 0) заполняет матрицы A и B
     if (rank == 0) {
+        A = (int*)malloc((size_t)n * n * sizeof(int));
+        C = (int*)malloc((size_t)n * n * sizeof(int));
+        C_pipelined = (int*)malloc((size_t)n * n * sizeof(int));
         srand(time(NULL));
-        fill_matrix(A, MATRIX_SIZE, MATRIX_SIZE);
-        fill_matrix(B, MATRIX_SIZE, MATRIX_SIZE);
-        start_time = MPI_Wtime(); // Засекаем время начала вычислений
+        fill_matrix(A, n, n);
+        fill_matrix(B, n, n);
+    }
+
+    // 1. Блокирующий вариант: каждая фаза замеряется отдельно
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start_time = MPI_Wtime();
+
+    MPI_Scatterv(A, counts, displs, MPI_INT, local_A, counts[rank], MPI_INT, 0, MPI_COMM_WORLD);
+    double t_scattered = MPI_Wtime();
+
+    MPI_Bcast(B, n * n, MPI_INT, 0, MPI_COMM_WORLD);
+    double t_broadcast = MPI_Wtime();
+
+    gemm(local_rows, n, n, local_A, n, B, n, local_C, n);
+    double t_computed = MPI_Wtime();
+
+    MPI_Gatherv(local_C, counts[rank], MPI_INT, C, counts, displs, MPI_INT, 0, MPI_COMM_WORLD);
+    double end_time = MPI_Wtime();
+
+    double scatter_time = max_over_processes(t_scattered - start_time);
+    double bcast_time = max_over_processes(t_broadcast - t_scattered);
+    double compute_time = max_over_processes(t_computed - t_broadcast);
+    double gather_time = max_over_processes(end_time - t_computed);
+    double blocking_time = max_over_processes(end_time - start_time);
+
+    // 2. Конвейерный вариант: все полосы B рассылаются сразу, вклад полосы считается, как
+    //    только она пришла. Время в MPI_Wait - та часть рассылки, которая не скрылась за вычислениями
+    if (rank != 0)
+        memset(B, 0, (size_t)n * n * sizeof(int));
+    int chunk_rows = n / MIN_B_CHUNKS < B_CHUNK_ROWS ? n / MIN_B_CHUNKS : B_CHUNK_ROWS;
+    if (chunk_rows < 1)
+        chunk_rows = 1;
+    int chunks = (n + chunk_rows - 1) / chunk_rows;
+    MPI_Request* requests = (MPI_Request*)malloc(chunks * sizeof(MPI_Request));
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    start_time = MPI_Wtime();
+
+    MPI_Scatterv(A, counts, displs, MPI_INT, local_A, counts[rank], MPI_INT, 0, MPI_COMM_WORLD);
+    for (int c = 0; c < chunks; c++) {
+        int first = c * chunk_rows;
+        int rows = n - first < chunk_rows ? n - first : chunk_rows;
+        MPI_Ibcast(B + (size_t)first * n, rows * n, MPI_INT, 0, MPI_COMM_WORLD, &requests[c]);
     }
 
-    // Распределение строк матрицы A между процессами
-    MPI_Scatter(A, rows_per_process * MATRIX_SIZE, MPI_INT, local_A, rows_per_process * MATRIX_SIZE, MPI_INT, 0, MPI_COMM_WORLD);
+    double wait_time = 0, pipelined_compute = 0;
+    for (int c = 0; c < chunks; c++) {
+        int first = c * chunk_rows;
+        int rows = n - first < chunk_rows ? n - first : chunk_rows;
 
-    // Передача всей матрицы B всем процессам
-    MPI_Bcast(B, MATRIX_SIZE * MATRIX_SIZE, MPI_INT, 0, MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        MPI_Wait(&requests[c], MPI_STATUS_IGNORE);
+        double t1 = MPI_Wtime();
 
-    // Параллельное перемножение матриц
-    for (int i = 0; i < rows_per_process; i++) {
-        for (int j = 0; j < MATRIX_SIZE; j++) {
-            local_C[i * MATRIX_SIZE + j] = 0;
-            for (int k = 0; k < MATRIX_SIZE; k++) {
-                local_C[i * MATRIX_SIZE + j] += local_A[i * MATRIX_SIZE + k] * B[k * MATRIX_SIZE + j];
-            }
-        }
+        // local_C += local_A[:, first:first + rows] * B[first:first + rows, :]
+        gemm(local_rows, n, rows, local_A + first, n, B + (size_t)first * n, n, local_C, n, c == 0 ? 0 : 1);
+        wait_time += t1 - t0;
+        pipelined_compute += MPI_Wtime() - t1;
     }
 
-    // Сборка результирующей матрицы C из локальных частей
-    MPI_Gather(local_C, rows_per_process * MATRIX_SIZE, MPI_INT, C, rows_per_process * MATRIX_SIZE, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(local_C, counts[rank], MPI_INT, C_pipelined, counts, displs, MPI_INT, 0, MPI_COMM_WORLD);
+    end_time = MPI_Wtime();
+
+    double pipelined_time = max_over_processes(end_time - start_time);
+    double exposed_time = max_over_processes(wait_time);
+    double pipelined_compute_time = max_over_processes(pipelined_compute);
 
     // Вывод результатов и времени выполнения только в корневом процессе
     if (rank == 0) {
-        end_time = MPI_Wtime();
-
         printf("\n=== Matrix Multiplication Results ===\n");
         printf("\nFirst 5x5 elements of the resulting matrix:\n");
-        print_matrix_slice(C, MATRIX_SIZE, MATRIX_SIZE, 5);
+        print_matrix_slice(C, n, n, 5);
+
+        printf("Matrix size: %dx%d\n", n, n);
+        printf("Number of processes: %d (%d to %d rows each)\n", size, n / size, (n + size - 1) / size);
+
+        printf("\nBlocking:  scatter %.2f ms, broadcast %.2f ms, compute %.2f ms, gather %.2f ms\n",
+            scatter_time * 1000, bcast_time * 1000, compute_time * 1000, gather_time * 1000);
+        printf("Blocking execution time:  %.3f seconds\n", blocking_time);
+
+        printf("\nPipelined: %d chunks of %d rows, compute %.2f ms, waiting for B %.2f ms\n", chunks, chunk_rows,
+            pipelined_compute_time * 1000, exposed_time * 1000);
+        printf("Pipelined execution time: %.3f seconds\n", pipelined_time);
+
+        // Скрытая часть рассылки: насколько ожидание B меньше блокирующего MPI_Bcast
+        double hidden = bcast_time > exposed_time ? bcast_time - exposed_time : 0;
+        printf("Hidden communication: %.2f ms of %.2f ms (%.0f%%)\n", hidden * 1000, bcast_time * 1000,
+            bcast_time > 0 ? 100 * hidden / bcast_time : 0.0);
 
-        printf("Matrix size: %dx%d\n", MATRIX_SIZE, MATRIX_SIZE);
-        printf("Number of processes: %d\n", size);
-        printf("Execution time: %.3f seconds\n", end_time - start_time);
+        int equal = memcmp(C, C_pipelined, (size_t)n * n * sizeof(int)) == 0;
+        printf("Results are %s\n", equal ? "correct (equal)" : "different (error)");
 
         // Освобождение памяти у корневого процесса
         free(A);
-        free(B);
         free(C);
+        free(C_pipelined);
     }
 
     // Освобождение локальной памяти у всех процессов
+    free(B);
     free(local_A);
     free(local_C);
+    free(counts);
+    free(displs);
+    free(requests);
 
     // Завершение работы MPI
     MPI_Finalize();
@@ -0,0 +1,409 @@
+﻿#include <mpi.h>
+#include <omp.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "../../Practice 19.02/Matrix/Gemm.h"
+
+using namespace std;
+
+// Умножение квадратных матриц n x n, распределённых блоками по двумерной решётке процессов.
+// Процесс (r, c) хранит только блоки A, B и C своей клетки - O(n^2 / p) памяти.
+// SUMMA: на каждом шаге столбец-владелец рассылает панель A по строке решётки, строка-владелец -
+// панель B по столбцу, рассылка следующей панели (MPI_Ibcast) идёт во время умножения текущей.
+// Cannon (только для квадратной решётки): после начального сдвига блоки A уходят влево,
+// блоки B - вверх, пересылка следующих блоков тоже идёт во время умножения.
+// Локальное умножение - блочное gemm с SIMD-микроядром.
+//   mpirun -n P "MPI SUMMA" [n] [weak_n]
+// n - размер для сильной масштабируемости (по умолчанию 2048), weak_n - размер на одном
+// процессе для слабой (по умолчанию 1024, n^3 / p постоянно). Замеры идут на подмножествах
+// из 1, 2, 4, ... процессов внутри одного запуска.
+
+const int DEFAULT_SIZE = 2048;
+const int DEFAULT_WEAK_SIZE = 1024;
+// Наибольшая ширина панели SUMMA
+const int PANEL_WIDTH = 256;
+
+// Начало части i при делении n на parts частей
+int blockBegin(int n, int i, int parts) {
+    return (int)((long long)n * i / parts);
+}
+
+// Номер части, которой принадлежит индекс idx
+int blockOwner(int n, int idx, int parts) {
+    int i = (int)(((long long)idx * parts + parts - 1) / n);
+    while (i > 0 && blockBegin(n, i, parts) > idx)
+        --i;
+    while (blockBegin(n, i + 1, parts) <= idx)
+        ++i;
+    return i;
+}
+
+// Элемент матрицы по глобальным индексам (splitmix64), одинаковый при любом числе процессов
+double matrixEntry(uint64_t seed, int i, int j) {
+    uint64_t x = seed * 0x9E3779B97F4A7C15ull + (((uint64_t)i << 32) | (uint32_t)j);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return (x >> 11) * 0x1.0p-53 * 2 - 1;
+}
+
+// Декартова решётка процессов и её строки и столбцы
+struct Grid {
+    MPI_Comm comm, row_comm, col_comm;
+    int rows, cols;  // размеры решётки
+    int row, col;    // координаты процесса
+};
+
+Grid makeGrid(MPI_Comm comm) {
+    Grid g;
+    int size;
+    MPI_Comm_size(comm, &size);
+    int dims[2] = { 0, 0 }, periods[2] = { 1, 1 }, coords[2];
+    MPI_Dims_create(size, 2, dims);
+    MPI_Cart_create(comm, 2, dims, periods, 0, &g.comm);
+
+    int rank;
+    MPI_Comm_rank(g.comm, &rank);
+    MPI_Cart_coords(g.comm, rank, 2, coords);
+    g.rows = dims[0];
+    g.cols = dims[1];
+    g.row = coords[0];
+    g.col = coords[1];
+
+    // В строке решётки номер процесса равен номеру столбца, в столбце - номеру строки
+    int keep_row[2] = { 0, 1 }, keep_col[2] = { 1, 0 };
+    MPI_Cart_sub(g.comm, keep_row, &g.row_comm);
+    MPI_Cart_sub(g.comm, keep_col, &g.col_comm);
+    return g;
+}
+
+void freeGrid(Grid& g) {
+    MPI_Comm_free(&g.row_comm);
+    MPI_Comm_free(&g.col_comm);
+    MPI_Comm_free(&g.comm);
+}
+
+// Блок клетки (r, c): строки по строкам решётки, столбцы - по столбцам. У всех трёх
+// матриц одинаковое разбиение, поэтому k-диапазон A совпадает со столбцами, а B - со строками
+struct LocalBlock {
+    int m0, m1, n0, n1;
+    int rows() const { return m1 - m0; }
+    int cols() const { return n1 - n0; }
+};
+
+LocalBlock localBlock(const Grid& g, int n) {
+    return { blockBegin(n, g.row, g.rows), blockBegin(n, g.row + 1, g.rows), blockBegin(n, g.col, g.cols),
+        blockBegin(n, g.col + 1, g.cols) };
+}
+
+void fillBlock(vector<double>& M, const LocalBlock& b, uint64_t seed) {
+    M.resize((size_t)b.rows() * b.cols());
+    for (int i = 0; i < b.rows(); ++i)
+        for (int j = 0; j < b.cols(); ++j)
+            M[(size_t)i * b.cols() + j] = matrixEntry(seed, b.m0 + i, b.n0 + j);
+}
+
+// Время умножения: всё, чистое умножение и ожидание обменов
+struct Timing {
+    double total, compute, wait;
+};
+
+// SUMMA: панели по k не пересекают границ блоков ни по строкам, ни по столбцам решётки
+Timing summaMultiply(const Grid& g, int n, const vector<double>& A, const vector<double>& B, vector<double>& C) {
+    const LocalBlock blk = localBlock(g, n);
+    const int mloc = blk.rows(), nloc = blk.cols();
+
+    vector<int> bounds;
+    for (int i = 0; i <= g.rows; ++i)
+        bounds.push_back(blockBegin(n, i, g.rows));
+    for (int j = 0; j <= g.cols; ++j)
+        bounds.push_back(blockBegin(n, j, g.cols));
+    sort(bounds.begin(), bounds.end());
+    bounds.erase(unique(bounds.begin(), bounds.end()), bounds.end());
+
+    vector<pair<int, int>> panels;
+    for (size_t b = 0; b + 1 < bounds.size(); ++b)
+        for (int k0 = bounds[b]; k0 < bounds[b + 1]; k0 += PANEL_WIDTH)
+            panels.push_back({ k0, min(k0 + PANEL_WIDTH, bounds[b + 1]) });
+
+    vector<double> a_buf[2], b_buf[2];
+    for (int t = 0; t < 2; ++t) {
+        a_buf[t].resize((size_t)mloc * PANEL_WIDTH);
+        b_buf[t].resize((size_t)PANEL_WIDTH * nloc);
+    }
+    MPI_Request requests[2][2];
+
+    // Панель s: владелец копирует свою часть в буфер и начинает рассылку
+    auto post = [&](int s) {
+        const int k0 = panels[s].first, w = panels[s].second - k0;
+        const int owner_col = blockOwner(n, k0, g.cols), owner_row = blockOwner(n, k0, g.rows);
+        double* a = a_buf[s % 2].data();
+        double* b = b_buf[s % 2].data();
+        if (g.col == owner_col) {
+            const int offset = k0 - blk.n0;
+            for (int i = 0; i < mloc; ++i)
+                copy(&A[(size_t)i * nloc + offset], &A[(size_t)i * nloc + offset] + w, a + (size_t)i * w);
+        }
+        if (g.row == owner_row)
+            copy(&B[(size_t)(k0 - blk.m0) * nloc], &B[(size_t)(k0 - blk.m0) * nloc] + (size_t)w * nloc, b);
+        MPI_Ibcast(a, mloc * w, MPI_DOUBLE, owner_col, g.row_comm, &requests[s % 2][0]);
+        MPI_Ibcast(b, w * nloc, MPI_DOUBLE, owner_row, g.col_comm, &requests[s % 2][1]);
+    };
+
+    C.assign((size_t)mloc * nloc, 0.0);
+    Timing t = { 0, 0, 0 };
+    MPI_Barrier(g.comm);
+    double start = MPI_Wtime();
+
+    post(0);
+    for (size_t s = 0; s < panels.size(); ++s) {
+        if (s + 1 < panels.size())
+            post((int)s + 1);
+
+        double t0 = MPI_Wtime();
+        MPI_Waitall(2, requests[s % 2], MPI_STATUSES_IGNORE);
+        double t1 = MPI_Wtime();
+        const int w = panels[s].second - panels[s].first;
+        gemm(mloc, nloc, w, a_buf[s % 2].data(), w, b_buf[s % 2].data(), nloc, C.data(), nloc, 1.0);
+        t.wait += t1 - t0;
+        t.compute += MPI_Wtime() - t1;
+    }
+
+    t.total = MPI_Wtime() - start;
+    return t;
+}
+
+// Cannon на квадратной решётке q x q: после шага s процесс (r, c) держит A(r, (r + c + s) mod q)
+// и B((r + c + s) mod q, c)
+Timing cannonMultiply(const Grid& g, int n, const vector<double>& A, const vector<double>& B, vector<double>& C) {
+    const int q = g.rows, r = g.row, c = g.col;
+    auto size = [&](int i) { return blockBegin(n, i + 1, q) - blockBegin(n, i, q); };
+    const int mloc = size(r), nloc = size(c);
+
+    size_t max_block = 0;
+    for (int i = 0; i < q; ++i)
+        max_block = max(max_block, (size_t)size(i) * max(mloc, nloc));
+    vector<double> a_cur(max_block), a_next(max_block), b_cur(max_block), b_next(max_block);
+
+    C.assign((size_t)mloc * nloc, 0.0);
+    Timing t = { 0, 0, 0 };
+    MPI_Barrier(g.comm);
+    double start = MPI_Wtime();
+
+    // Начальный сдвиг: строка r сдвигает A влево на r, столбец c сдвигает B вверх на c
+    int src, dst;
+    MPI_Cart_shift(g.comm, 1, -r, &src, &dst);
+    MPI_Sendrecv(A.data(), (int)A.size(), MPI_DOUBLE, dst, 0, a_cur.data(), mloc * size((c + r) % q), MPI_DOUBLE, src,
+        0, g.comm, MPI_STATUS_IGNORE);
+    MPI_Cart_shift(g.comm, 0, -c, &src, &dst);
+    MPI_Sendrecv(B.data(), (int)B.size(), MPI_DOUBLE, dst, 1, b_cur.data(), size((r + c) % q) * nloc, MPI_DOUBLE, src,
+        1, g.comm, MPI_STATUS_IGNORE);
+    t.wait = MPI_Wtime() - start;
+
+    int left, right, up, down;
+    MPI_Cart_shift(g.comm, 1, -1, &right, &left);
+    MPI_Cart_shift(g.comm, 0, -1, &down, &up);
+
+    for (int s = 0; s < q; ++s) {
+        const int kc = (r + c + s) % q, kn = (kc + 1) % q;
+        MPI_Request requests[4];
+        int pending = 0;
+        if (s + 1 < q) {
+            MPI_Irecv(a_next.data(), mloc * size(kn), MPI_DOUBLE, right, 2, g.comm, &requests[pending++]);
+            MPI_Irecv(b_next.data(), size(kn) * nloc, MPI_DOUBLE, down, 3, g.comm, &requests[pending++]);
+            MPI_Isend(a_cur.data(), mloc * size(kc), MPI_DOUBLE, left, 2, g.comm, &requests[pending++]);
+            MPI_Isend(b_cur.data(), size(kc) * nloc, MPI_DOUBLE, up, 3, g.comm, &requests[pending++]);
+        }
+
+        double t0 = MPI_Wtime();
+        gemm(mloc, nloc, size(kc), a_cur.data(), size(kc), b_cur.data(), nloc, C.data(), nloc, 1.0);
+        double t1 = MPI_Wtime();
+        MPI_Waitall(pending, requests, MPI_STATUSES_IGNORE);
+        t.compute += t1 - t0;
+        t.wait += MPI_Wtime() - t1;
+
+        swap(a_cur, a_next);
+        swap(b_cur, b_next);
+    }
+
+    t.total = MPI_Wtime() - start;
+    return t;
+}
+
+// y = M x для матрицы, распределённой по решётке; x и y целиком на каждом процессе
+vector<double> gridMatVec(const Grid& g, int n, const vector<double>& M, const vector<double>& x) {
+    const LocalBlock blk = localBlock(g, n);
+    vector<double> part(blk.rows(), 0.0);
+    for (int i = 0; i < blk.rows(); ++i)
+        for (int j = 0; j < blk.cols(); ++j)
+            part[i] += M[(size_t)i * blk.cols() + j] * x[blk.n0 + j];
+    MPI_Allreduce(MPI_IN_PLACE, part.data(), blk.rows(), MPI_DOUBLE, MPI_SUM, g.row_comm);
+
+    vector<int> counts(g.rows), displs(g.rows);
+    for (int i = 0; i < g.rows; ++i) {
+        displs[i] = blockBegin(n, i, g.rows);
+        counts[i] = blockBegin(n, i + 1, g.rows) - displs[i];
+    }
+    vector<double> y(n);
+    MPI_Allgatherv(part.data(), blk.rows(), MPI_DOUBLE, y.data(), counts.data(), displs.data(), MPI_DOUBLE, g.col_comm);
+    return y;
+}
+
+// Проверка Фрейвалдса: C x против A (B x), относительная ошибка
+double verifyProduct(const Grid& g, int n, const vector<double>& A, const vector<double>& B, const vector<double>& C) {
+    vector<double> x(n);
+    for (int j = 0; j < n; ++j)
+        x[j] = matrixEntry(3, j, 0);
+    vector<double> cx = gridMatVec(g, n, C, x);
+    vector<double> abx = gridMatVec(g, n, A, gridMatVec(g, n, B, x));
+
+    double difference = 0, magnitude = 0;
+    for (int i = 0; i < n; ++i) {
+        difference = max(difference, fabs(cx[i] - abx[i]));
+        magnitude = max(magnitude, fabs(abx[i]));
+    }
+    return difference / max(magnitude, 1e-300);
+}
+
+struct RunResult {
+    Timing time;     // максимум по процессам
+    double error;
+    double memory;   // байт на процесс, максимум
+};
+
+// Одно умножение на процессах comm; результат - на нулевом процессе comm
+RunResult runMultiply(MPI_Comm comm, int n, bool cannon, int& grid_rows, int& grid_cols) {
+    Grid g = makeGrid(comm);
+    grid_rows = g.rows;
+    grid_cols = g.cols;
+
+    const LocalBlock blk = localBlock(g, n);
+    vector<double> A, B, C;
+    fillBlock(A, blk, 1);
+    fillBlock(B, blk, 2);
+
+    // Лучший из трёх запусков
+    Timing t = { 1e30, 0, 0 };
+    for (int run = 0; run < 3; ++run) {
+        Timing current = cannon ? cannonMultiply(g, n, A, B, C) : summaMultiply(g, n, A, B, C);
+        if (current.total < t.total)
+            t = current;
+    }
+
+    // Память SUMMA: блоки A, B, C и по два буфера панелей A и B
+    const double memory = (3.0 * blk.rows() * blk.cols() + 2.0 * (blk.rows() + blk.cols()) * PANEL_WIDTH) * sizeof(double);
+
+    RunResult result;
+    double local[4] = { t.total, t.compute, t.wait, memory }, global[4];
+    MPI_Reduce(local, global, 4, MPI_DOUBLE, MPI_MAX, 0, comm);
+    result.time = { global[0], global[1], global[2] };
+    result.memory = global[3];
+    result.error = verifyProduct(g, n, A, B, C);
+
+    freeGrid(g);
+    return result;
+}
+
+// Потоки gemm: если OMP_NUM_THREADS не задан, ядра узла делятся между его процессами
+void setThreadsPerProcess() {
+    if (getenv("OMP_NUM_THREADS"))
+        return;
+    MPI_Comm node;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+    int local;
+    MPI_Comm_size(node, &local);
+    omp_set_num_threads(max(1, omp_get_num_procs() / local));
+    MPI_Comm_free(&node);
+}
+
+int main(int argc, char** argv) {
+    int rank, size;
+
+    // Инициализация MPI
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);  // номер текущего процесса
+    MPI_Comm_size(MPI_COMM_WORLD, &size);  // общее количество процессов
+
+    const int n = argc > 1 ? atoi(argv[1]) : DEFAULT_SIZE;
+    const int weak_n = argc > 2 ? atoi(argv[2]) : DEFAULT_WEAK_SIZE;
+    setThreadsPerProcess();
+
+    // Число процессов в замерах: степени двойки, квадраты и все процессы
+    vector<int> counts;
+    for (int p = 1; p <= size; p *= 2)
+        counts.push_back(p);
+    for (int q = 3; q * q <= size; ++q)
+        counts.push_back(q * q);
+    counts.push_back(size);
+    sort(counts.begin(), counts.end());
+    counts.erase(unique(counts.begin(), counts.end()), counts.end());
+
+    if (rank == 0)
+        printf("Processes: %d, threads per process: %d, local kernel: %s\n", size, omp_get_max_threads(),
+            gemmIsaName(gemmIsa()));
+
+    double max_error = 0;
+    double base_summa = 0, base_cannon = 0;
+    for (int weak = 0; weak < 2; ++weak) {
+        if (rank == 0) {
+            if (!weak)
+                printf("\nStrong scaling, n = %d\n", n);
+            else
+                printf("\nWeak scaling, n^3 / p constant (n = %d on one process)\n", weak_n);
+            printf("procs  grid      n   SUMMA ms  wait ms  GFLOP/s  efficiency   Cannon ms  wait ms  efficiency"
+                   "   MB/proc\n");
+        }
+
+        for (int p : counts) {
+            const int np = weak ? (int)lround(weak_n * cbrt((double)p)) : n;
+
+            // Замер на первых p процессах, остальные ждут
+            MPI_Comm comm;
+            MPI_Comm_split(MPI_COMM_WORLD, rank < p ? 0 : MPI_UNDEFINED, rank, &comm);
+            RunResult summa = {}, cannon = {};
+            bool has_cannon = false;
+            int grid_rows = 0, grid_cols = 0;
+            if (comm != MPI_COMM_NULL) {
+                summa = runMultiply(comm, np, false, grid_rows, grid_cols);
+                has_cannon = grid_rows == grid_cols;
+                if (has_cannon)
+                    cannon = runMultiply(comm, np, true, grid_rows, grid_cols);
+                MPI_Comm_free(&comm);
+            }
+            max_error = max(max_error, max(summa.error, cannon.error));
+
+            if (rank == 0) {
+                // Сильная: T1 / (p Tp), слабая: T1 / Tp
+                const double scale = weak ? 1.0 : 1.0 / p;
+                if (p == 1) {
+                    base_summa = summa.time.total;
+                    base_cannon = cannon.time.total;
+                }
+                printf("%5d %3dx%-3d %6d %10.1f %8.1f %8.1f %10.0f%%", p, grid_rows, grid_cols, np,
+                    summa.time.total * 1000, summa.time.wait * 1000, 2.0 * np * np * np / summa.time.total / 1e9,
+                    100 * scale * base_summa / summa.time.total);
+                if (has_cannon)
+                    printf(" %11.1f %8.1f %10.0f%%", cannon.time.total * 1000, cannon.time.wait * 1000,
+                        100 * scale * base_cannon / cannon.time.total);
+                else
+                    printf(" %11s %8s %11s", "-", "-", "-");
+                printf(" %9.1f\n", summa.memory / 1048576);
+            }
+            MPI_Barrier(MPI_COMM_WORLD);
+        }
+    }
+
+    double global_error;
+    MPI_Reduce(&max_error, &global_error, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        printf("\nMax relative error (Freivalds check): %.1e\n", global_error);
+        printf("Results are %s\n", global_error < 1e-10 ? "correct" : "incorrect");
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,324 @@
+﻿#include <mpi.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <cerrno>
+#include <random>
+#include <algorithm>
+#include "../../Practice 19.02/Bubble sort/Sorting Networks.h"
+
+using namespace std;
+
+// Распределённая выборочная сортировка (PSRS): каждый процесс сортирует свою часть,
+// по регулярной выборке выбираются разделители, ключи пересылаются через MPI_Alltoallv,
+// и каждый процесс сливает полученные отсортированные отрезки.
+//   mpirun -n P "MPI Sort" [N] [--input input.bin] [--output output.bin]
+// N - общее число случайных ключей (по умолчанию 10^7), input.bin - файл 32-битных ключей.
+// Если задан output.bin, результат записывается в него по порядку процессов.
+// Затем те же N ключей сортируются ещё раз с DUPLICATE_KEYS различными значениями: разделители
+// сравниваются как пары (ключ, место), поэтому серии равных ключей делятся между процессами,
+// и нагрузка остаётся равной и при большом числе повторов.
+
+const long long DEFAULT_SIZE = 10000000;
+// Различных ключей во втором, «повторяющемся» наборе
+const int DUPLICATE_KEYS = 16;
+
+// Элемент выборки: ключ и его место index * size + rank, где index - индекс после локальной
+// сортировки. Лексикографический порядок пар строгий даже при равных ключах, а равные ключи
+// разных процессов в нём чередуются: части процессов одинаково распределены, поэтому серия
+// ключа начинается у всех примерно с одного индекса, и разделитель делит её между всеми поровну
+struct SampleKey {
+    long long key, position;
+
+    bool operator<(const SampleKey& other) const {
+        return key != other.key ? key < other.key : position < other.position;
+    }
+};
+
+// Начало части процесса rank при делении total элементов на size частей
+long long shardBegin(long long total, int rank, int size) {
+    long long per_proc = total / size, remainder = total % size;
+    return rank * per_proc + min<long long>(rank, remainder);
+}
+
+// Чтение своей части файла ключей; false, если файл не открылся
+bool readShard(const char* path, vector<int>& local, long long& total, int rank, int size) {
+    MPI_File file;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        return false;
+
+    MPI_Offset bytes;
+    MPI_File_get_size(file, &bytes);
+    total = bytes / sizeof(int);
+
+    long long begin = shardBegin(total, rank, size), end = shardBegin(total, rank + 1, size);
+    local.resize(end - begin);
+    MPI_File_read_at_all(file, begin * sizeof(int), local.data(), (int)local.size(), MPI_INT, MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+    return true;
+}
+
+// Случайные ключи; distinct > 0 - только distinct различных значений
+void generateShard(vector<int>& local, long long total, int rank, int size, int distinct = 0) {
+    long long begin = shardBegin(total, rank, size), end = shardBegin(total, rank + 1, size);
+    local.resize(end - begin);
+    mt19937 gen(12345 + rank);
+    for (auto& x : local)
+        x = distinct > 0 ? (int)(gen() % distinct) : (int)gen();
+}
+
+// Сумма ключей для проверки, что при пересылке ничего не потерялось
+long long checksum(const vector<int>& local) {
+    long long local_sum = 0, total_sum = 0;
+    for (int x : local)
+        local_sum += x;
+    MPI_Allreduce(&local_sum, &total_sum, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    return total_sum;
+}
+
+// Распределённая проверка: каждая часть отсортирована, а её первый ключ не меньше
+// наибольшего ключа всех предыдущих процессов (пустые части пропускаются)
+bool isSortedGlobal(const vector<int>& local, int rank) {
+    bool ok = is_sorted(local.begin(), local.end());
+
+    int local_max = local.empty() ? INT_MIN : local.back();
+    int prev_max = INT_MIN;
+    MPI_Exscan(&local_max, &prev_max, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (rank == 0)
+        prev_max = INT_MIN;  // MPI_Exscan не определяет результат на нулевом процессе
+    if (!local.empty() && local.front() < prev_max)
+        ok = false;
+
+    int local_ok = ok, all_ok = 0;
+    MPI_Allreduce(&local_ok, &all_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return all_ok != 0;
+}
+
+// Слияние size отсортированных отрезков попарно, как в сортировке слиянием снизу вверх
+void mergeReceivedRuns(vector<int>& data, const vector<int>& displs, const vector<int>& counts) {
+    vector<long long> bounds(counts.size() + 1);
+    for (size_t i = 0; i < counts.size(); ++i)
+        bounds[i] = displs[i];
+    bounds[counts.size()] = data.size();
+
+    vector<int> buffer(data.size());
+    int* src = data.data();
+    int* dst = buffer.data();
+    while (bounds.size() > 2) {
+        vector<long long> merged_bounds;
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            long long lo = bounds[i], mid = bounds[i + 1];
+            long long hi = i + 2 < bounds.size() ? bounds[i + 2] : mid;
+            mergeRuns(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+            merged_bounds.push_back(lo);
+        }
+        merged_bounds.push_back(bounds.back());
+        bounds.swap(merged_bounds);
+        swap(src, dst);
+    }
+    if (src != data.data())
+        copy(src, src + data.size(), data.data());
+}
+
+// Конец части, которая уходит процессу с разделителем splitter справа: элементы, не большие
+// splitter в порядке (ключ, место). Из равных ключу элементов идут те, у кого
+// index * size + rank <= splitter.position
+size_t partitionEnd(const vector<int>& local, size_t from, const SampleKey& splitter, int rank, int size) {
+    const int key = (int)splitter.key;
+    const size_t lo = lower_bound(local.begin() + from, local.end(), key) - local.begin();
+    const size_t hi = upper_bound(local.begin() + lo, local.end(), key) - local.begin();
+    const size_t count = splitter.position < rank ? 0 : (size_t)((splitter.position - rank) / size) + 1;
+    return min(max(count, lo), hi);
+}
+
+// Запись результата по порядку процессов; false, если файл не открылся или запись не удалась
+bool writeSorted(const char* path, const vector<int>& local) {
+    long long count = (long long)local.size(), offset = 0;
+    MPI_Exscan(&count, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0)
+        offset = 0;
+
+    MPI_File file;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        return false;
+    int ok = MPI_File_set_size(file, 0) == MPI_SUCCESS;
+    ok = MPI_File_write_at_all(file, offset * sizeof(int), local.data(), (int)local.size(), MPI_INT,
+             MPI_STATUS_IGNORE) == MPI_SUCCESS && ok;
+    ok = MPI_File_close(&file) == MPI_SUCCESS && ok;
+
+    int all_ok = 0;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return all_ok != 0;
+}
+
+// Число ключей: вся строка - положительное целое
+bool parseCount(const char* text, long long& value) {
+    char* end = nullptr;
+    errno = 0;
+    value = strtoll(text, &end, 10);
+    return errno == 0 && end != text && *end == '\0' && value > 0;
+}
+
+struct SortOptions {
+    long long total = DEFAULT_SIZE;
+    string input, output;
+};
+
+bool parseArgs(int argc, char** argv, SortOptions& opt) {
+    bool have_count = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--input" && i + 1 < argc)
+            opt.input = argv[++i];
+        else if (arg == "--output" && i + 1 < argc)
+            opt.output = argv[++i];
+        else if (!have_count && parseCount(argv[i], opt.total))
+            have_count = true;
+        else
+            return false;
+    }
+    return true;
+}
+
+// Сортировка local и отчёт о фазах на процессе 0; output - файл результата или пустая строка.
+// Возвращает false, если результат неверен или не записался
+bool sortAndReport(vector<int>& local, long long total, const char* label, const string& output, int rank, int size) {
+    long long sum_before = checksum(local);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_start = MPI_Wtime();
+
+    // 1. Локальная сортировка
+    networkSort(local.data(), local.size());
+    double t_sorted = MPI_Wtime();
+
+    // 2. Регулярная выборка: size - 1 ключей с каждого процесса вместе с их местом, из всех
+    //    выборок берутся size - 1 разделителей с равным шагом
+    vector<SampleKey> samples(size - 1);
+    for (int i = 0; i < size - 1; ++i) {
+        const size_t index = local.empty() ? 0 : local.size() * (i + 1) / size;
+        samples[i].key = local.empty() ? INT_MAX : local[index];
+        samples[i].position = (long long)index * size + rank;
+    }
+
+    vector<SampleKey> all_samples((size_t)size * (size - 1));
+    MPI_Allgather(samples.data(), 2 * (size - 1), MPI_LONG_LONG, all_samples.data(), 2 * (size - 1), MPI_LONG_LONG,
+        MPI_COMM_WORLD);
+    sort(all_samples.begin(), all_samples.end());
+
+    vector<SampleKey> splitters(size - 1);
+    for (int i = 0; i < size - 1; ++i)
+        splitters[i] = all_samples[(size_t)(i + 1) * (size - 1)];
+    double t_sampled = MPI_Wtime();
+
+    // 3. Обмен: ключи от splitters[i - 1] до splitters[i] уходят процессу i
+    vector<int> send_counts(size), send_displs(size), recv_counts(size), recv_displs(size);
+    size_t pos = 0;
+    for (int i = 0; i < size; ++i) {
+        size_t end = i < size - 1 ? partitionEnd(local, pos, splitters[i], rank, size) : local.size();
+        send_displs[i] = (int)pos;
+        send_counts[i] = (int)(end - pos);
+        pos = end;
+    }
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+    long long received = 0;
+    for (int i = 0; i < size; ++i) {
+        recv_displs[i] = (int)received;
+        received += recv_counts[i];
+    }
+
+    vector<int> sorted(received);
+    MPI_Alltoallv(local.data(), send_counts.data(), send_displs.data(), MPI_INT,
+        sorted.data(), recv_counts.data(), recv_displs.data(), MPI_INT, MPI_COMM_WORLD);
+    double t_exchanged = MPI_Wtime();
+
+    // 4. Слияние полученных отрезков
+    vector<int>().swap(local);
+    mergeReceivedRuns(sorted, recv_displs, recv_counts);
+    double t_merged = MPI_Wtime();
+
+    // Время фазы - максимум по процессам
+    double phases[5] = { t_sorted - t_start, t_sampled - t_sorted, t_exchanged - t_sampled,
+        t_merged - t_exchanged, t_merged - t_start };
+    double max_phases[5];
+    MPI_Reduce(phases, max_phases, 5, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    long long min_size, max_size;
+    MPI_Reduce(&received, &min_size, 1, MPI_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&received, &max_size, 1, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    // Проверка результата
+    bool sorted_ok = isSortedGlobal(sorted, rank);
+    bool sum_ok = checksum(sorted) == sum_before;
+
+    bool written = true;
+    if (!output.empty()) {
+        written = writeSorted(output.c_str(), sorted);
+        if (!written && rank == 0)
+            cerr << "Error: Failed to write " << output << endl;
+    }
+
+    if (rank == 0) {
+        printf("%s\n", label);
+        printf("Keys: %lld, processes: %d, local kernel: %s\n", total, size, simdLevelName(simdLevel()));
+        printf("Local sort: %.2f ms\n", max_phases[0] * 1000);
+        printf("Sampling:   %.2f ms\n", max_phases[1] * 1000);
+        printf("Exchange:   %.2f ms\n", max_phases[2] * 1000);
+        printf("Merge:      %.2f ms\n", max_phases[3] * 1000);
+        printf("Total time: %.2f ms (%.1f Mkeys/s)\n", max_phases[4] * 1000, total / max_phases[4] / 1e6);
+        printf("Keys per process after exchange: min %lld, max %lld (ideal %lld)\n", min_size, max_size,
+            total / size);
+        cout << "Result is " << (sorted_ok && sum_ok ? "correct" : "incorrect") << endl;
+    }
+
+    return sorted_ok && sum_ok && written;
+}
+
+int main(int argc, char** argv) {
+    int rank, size;
+
+    // Инициализация MPI
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);  // номер текущего процесса
+    MPI_Comm_size(MPI_COMM_WORLD, &size);  // общее количество процессов
+
+    SortOptions opt;
+    if (!parseArgs(argc, argv, opt)) {
+        if (rank == 0)
+            cerr << "Usage: " << argv[0] << " [N] [--input input.bin] [--output output.bin]" << endl;
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Получение своей части: из файла или генерация
+    vector<int> local;
+    long long total = opt.total;
+    if (!opt.input.empty()) {
+        if (!readShard(opt.input.c_str(), local, total, rank, size)) {
+            if (rank == 0)
+                cerr << "Error: Failed to open " << opt.input << endl;
+            MPI_Finalize();
+            return 1;
+        }
+    } else {
+        generateShard(local, total, rank, size);
+    }
+
+    bool ok = sortAndReport(local, total, opt.input.empty() ? "Random keys" : opt.input.c_str(), opt.output, rank, size);
+
+    // Много повторов: без деления серий равных ключей почти всё досталось бы нескольким процессам
+    vector<int> duplicates;
+    generateShard(duplicates, total, rank, size, DUPLICATE_KEYS);
+    char label[64];
+    snprintf(label, sizeof(label), "\n%d distinct keys", DUPLICATE_KEYS);
+    ok = sortAndReport(duplicates, total, label, "", rank, size) && ok;
+
+    MPI_Finalize();
+    return ok ? 0 : 1;
+}